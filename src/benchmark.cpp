@@ -0,0 +1,266 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "benchmark.h"
+#include "ogl.h"
+#include "course.h"
+#include "course_render.h"
+#include "env.h"
+#include "view.h"
+#include "physics.h"
+#include "game_ctrl.h"
+#include "winsys.h"
+#include "spx.h"
+#include "render_queue.h"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#define BENCH_FRAMES 600		// frames per course and renderer
+#define BENCH_TIMESTEP (1.f / 60.f)
+#define NUM_BENCH_RENDERERS 2
+
+CBenchmark Benchmark;
+
+struct TBenchRun {
+	std::vector<float> frame_ms;	// cpu time of each frame, including the swap
+	std::size_t triangles;
+	std::size_t draw_calls;
+};
+
+struct TBenchCourse {
+	CCourseList* group;
+	TCourse* course;
+	TBenchRun runs[NUM_BENCH_RENDERERS];
+};
+
+// The camera path as keyframes: the position along the course (0 at the
+// start, 1 at the end) and the lateral offset from the start point in
+// units of half the play width. The same path is flown on every course.
+struct TBenchKey {
+	double along;
+	double side;
+};
+
+static const TBenchKey bench_path[] = {
+	{0.0, 0.0}, {0.15, 0.3}, {0.35, -0.4}, {0.55, 0.5}, {0.75, -0.3}, {1.0, 0.0}
+};
+#define NUM_BENCH_KEYS (sizeof(bench_path) / sizeof(bench_path[0]))
+
+static const char* renderer_names[NUM_BENCH_RENDERERS] = {
+	"quadtree", "chunked"
+};
+
+static std::vector<TBenchCourse> bench_courses;
+static std::size_t curr_course;
+static int curr_renderer;
+static int frame;
+static int saved_renderer;
+
+static bool LoadBenchmarkData() {
+	Course.MakeStandardPolyhedrons();
+	if (!Course.LoadObjectTypes()) return false;
+	if (!Course.LoadTerrainTypes()) return false;
+	if (!Env.LoadEnvironmentList()) return false;
+	if (!Course.LoadCourseList()) return false;
+	if (!Players.LoadAvatars()) return false;
+	Players.LoadPlayers();
+	Players.AllocControl(0);
+	g_game.player = Players.GetPlayer(0);
+	return true;
+}
+
+// position of the camera target at the given frame, interpolated between
+// the keyframes with a smoothstep so that the heading changes gently
+static TVector2d PathPoint(double f) {
+	double along = clamp(0.0, f / (BENCH_FRAMES - 1), 1.0);
+	std::size_t k = 1;
+	while (k < NUM_BENCH_KEYS - 1 && bench_path[k].along < along) k++;
+	const TBenchKey& k0 = bench_path[k - 1];
+	const TBenchKey& k1 = bench_path[k];
+	double t = (along - k0.along) / (k1.along - k0.along);
+	t = t * t * (3.0 - 2.0 * t);
+	double side = k0.side + (k1.side - k0.side) * t;
+
+	double start_z = Course.GetStartPoint().y;
+	double end_z = -Course.GetPlayDimensions().y;
+	double width = Course.GetDimensions().x;
+	double x = Course.GetStartPoint().x + side * Course.GetPlayDimensions().x * 0.5;
+	return TVector2d(clamp(1.0, x, width - 1.0), start_z + (end_z - start_z) * along);
+}
+
+static void StartRun() {
+	TBenchCourse& bench = bench_courses[curr_course];
+	param.terrain_renderer = curr_renderer;
+	if (curr_renderer == 0) {
+		Course.currentCourseList = bench.group;
+		Course.LoadCourse(bench.course);
+		Env.LoadEnvironment(Course.GetEnv(), 0);
+	} else {
+		Course.InitTerrainRenderer();
+	}
+
+	CControl *ctrl = g_game.player->ctrl;
+	ctrl->cpos.x = Course.GetStartPoint().x;
+	ctrl->cpos.z = Course.GetStartPoint().y;
+	ctrl->Init();
+	ctrl->view_init = false;
+	set_view_mode(ctrl, ABOVE);
+	SetCameraDistance(4.0);
+	SetStationaryCamera(false);
+
+	TBenchRun& run = bench.runs[curr_renderer];
+	run.frame_ms.clear();
+	run.frame_ms.reserve(BENCH_FRAMES);
+	run.triangles = 0;
+	run.draw_calls = 0;
+}
+
+// the value below which the given fraction of the frames lie
+static float Percentile(std::vector<float> values, float fraction) {
+	if (values.empty()) return 0.f;
+	std::size_t n = std::min(values.size() - 1, (std::size_t)(fraction * values.size()));
+	std::nth_element(values.begin(), values.begin() + n, values.end());
+	return values[n];
+}
+
+static void PrintResults() {
+	std::string path = param.save_dir + SEP "benchmark_" + GetTimeString() + ".csv";
+	std::ofstream file(path.c_str());
+	if (file)
+		file << "course,renderer,frames,min_ms,avg_ms,p99_ms,triangles,draw_calls\n";
+	else
+		Message("could not write the benchmark results to", path);
+
+	Message("");
+	Message("benchmark, frame time min/avg/p99 and average per frame:");
+	for (std::size_t i = 0; i < bench_courses.size(); i++) {
+		const TBenchCourse& bench = bench_courses[i];
+		std::string line = bench.course->name + ':';
+		for (int r = 0; r < NUM_BENCH_RENDERERS; r++) {
+			const TBenchRun& run = bench.runs[r];
+			std::size_t frames = run.frame_ms.size();
+			if (frames == 0) continue;
+			float min_ms = *std::min_element(run.frame_ms.begin(), run.frame_ms.end());
+			float avg_ms = 0.f;
+			for (std::size_t f = 0; f < frames; f++) avg_ms += run.frame_ms[f];
+			avg_ms /= frames;
+			float p99_ms = Percentile(run.frame_ms, 0.99f);
+			std::size_t tris = run.triangles / frames;
+			std::size_t calls = run.draw_calls / frames;
+
+			line += std::string("  ") + renderer_names[r] + ' '
+			        + Float_StrN(min_ms, 2) + '/' + Float_StrN(avg_ms, 2) + '/'
+			        + Float_StrN(p99_ms, 2) + " ms "
+			        + Int_StrN((int)tris) + " tris "
+			        + Int_StrN((int)calls) + " calls";
+			if (file) {
+				file << bench.course->dir << ',' << renderer_names[r] << ',' << frames << ','
+				     << min_ms << ',' << avg_ms << ',' << p99_ms << ','
+				     << tris << ',' << calls << '\n';
+			}
+		}
+		Message(line);
+	}
+	if (file) Message("benchmark results written to", path);
+}
+
+void CBenchmark::Keyb(sf::Keyboard::Key key, bool release, int x, int y) {
+	if (!release && key == sf::Keyboard::Escape)
+		State::manager.RequestQuit();
+}
+
+void CBenchmark::Enter() {
+	Winsys.ShowCursor(false);
+	saved_renderer = param.terrain_renderer;
+	bench_courses.clear();
+	curr_course = 0;
+	curr_renderer = 0;
+	frame = 0;
+
+	if (!LoadBenchmarkData()) {
+		Message("could not load the data for the benchmark");
+		State::manager.RequestQuit();
+		return;
+	}
+
+	for (std::size_t g = 0; g < Course.CourseLists.size(); g++) {
+		CCourseList* group = Course.getGroup(g);
+		for (std::size_t i = 0; i < group->size(); i++) {
+			TBenchCourse bench;
+			bench.group = group;
+			bench.course = &(*group)[i];
+			bench_courses.push_back(bench);
+		}
+	}
+}
+
+void CBenchmark::Loop(float time_step) {
+	if (curr_course >= bench_courses.size()) {
+		PrintResults();
+		State::manager.RequestQuit();
+		return;
+	}
+	if (frame == 0) StartRun();
+
+	// the camera follows the keyframed path with a fixed timestep,
+	// independent of the real frame time
+	sf::Clock clock;
+	CControl *ctrl = g_game.player->ctrl;
+	TVector2d pos = PathPoint(frame);
+	TVector2d next = PathPoint(frame + 1);
+	ctrl->cpos.x = pos.x;
+	ctrl->cpos.z = pos.y;
+	ctrl->cpos.y = Course.FindYCoord(ctrl->cpos.x, ctrl->cpos.z);
+	ctrl->cvel = (1.0 / BENCH_TIMESTEP) * TVector3d(next.x - pos.x, 0, next.y - pos.y);
+
+	num_draw_calls = 0;
+	ClearRenderContext();
+	Reshape(Winsys.resolution.width, Winsys.resolution.height);
+	Env.SetupFog();
+	update_view(ctrl, BENCH_TIMESTEP);
+	SetupViewFrustum(ctrl);
+	Env.DrawSkybox(ctrl->viewpos);
+	Env.SetupLight();
+	RenderCourse();
+	DrawTrees();
+	RenderQueue.Flush();
+
+	Winsys.SwapBuffers();
+
+	TBenchRun& run = bench_courses[curr_course].runs[curr_renderer];
+	run.frame_ms.push_back(clock.getElapsedTime().asMicroseconds() / 1000.f);
+	run.triangles += GetCourseTriangles();
+	run.draw_calls += num_draw_calls;
+
+	if (++frame >= BENCH_FRAMES) {
+		frame = 0;
+		if (++curr_renderer >= NUM_BENCH_RENDERERS) {
+			curr_renderer = 0;
+			curr_course++;
+		}
+	}
+}
+
+void CBenchmark::Exit() {
+	param.terrain_renderer = saved_renderer;
+	Course.ResetCourse();
+}
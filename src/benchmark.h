@@ -0,0 +1,40 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "bh.h"
+#include "states.h"
+
+// Flies the camera along a keyframed path down every course, once with
+// each course renderer, at a fixed timestep. Prints min, average and p99
+// frame time, triangles and draw calls per frame and writes them to
+// benchmark_<time>.csv in the save directory for comparing builds.
+// Started with the command line argument --benchmark.
+
+class CBenchmark : public State {
+	void Enter();
+	void Loop(float time_step);
+	void Keyb(sf::Keyboard::Key key, bool release, int x, int y);
+	void Exit();
+public:
+};
+
+extern CBenchmark Benchmark;
+
+#endif
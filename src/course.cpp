@@ -27,6 +27,7 @@ GNU General Public License for more details.
 #include "track_marks.h"
 #include "spx.h"
 #include "quadtree.h"
+#include "terrain_chunks.h"
 #include "env.h"
 #include "game_ctrl.h"
 #include "font.h"
@@ -68,7 +69,8 @@ CCourse::CCourse()
 	, base_height_value(0)
 	, mirrored(false)
 	, currentCourseList(nullptr)
-	, vnc_array(nullptr) {
+	, vnc_array(nullptr)
+	, headless(false) {
 }
 
 CCourse::~CCourse() {
@@ -374,7 +376,7 @@ void CCourse::LoadItemList() {
 
 		std::string name = SPStrN(*line, "name");
 		std::size_t type = ObjectIndex[name];
-		if (ObjTypes[type].texture == nullptr && ObjTypes[type].drawable) {
+		if (ObjTypes[type].texture == nullptr && ObjTypes[type].drawable && !headless) {
 			std::string terrpath = param.obj_dir + SEP + ObjTypes[type].textureFile;
 			ObjTypes[type].texture = new TTexture();
 			ObjTypes[type].texture->Load(terrpath, false);
@@ -424,8 +426,9 @@ static void CalcRandomTrees(double baseheight, double basediam, double &height,
 	double hhh = baseheight * sizefact[g_game.treesize];
 	double minsiz = hhh / varfact[g_game.treevar];
 	double maxsiz = hhh * varfact[g_game.treevar];
-	height = XRandom(minsiz, maxsiz);
-	diam = XRandom(height/diamfact, height);
+	CRandom& rnd = RandomStream(RAND_TREES);
+	height = rnd.Range(minsiz, maxsiz);
+	diam = rnd.Range(height/diamfact, height);
 }
 
 bool CCourse::LoadAndConvertObjectMap() {
@@ -454,7 +457,7 @@ bool CCourse::LoadAndConvertObjectMap() {
 				cnt++;
 				double xx = (nx - x) / (double)((double)nx - 1.0) * curr_course->size.x;
 				double zz = -(int)(ny - y) / (double)((double)ny - 1.0) * curr_course->size.y;
-				if (ObjTypes[type].texture == nullptr && ObjTypes[type].drawable) {
+				if (ObjTypes[type].texture == nullptr && ObjTypes[type].drawable && !headless) {
 					std::string terrpath = param.obj_dir + SEP + ObjTypes[type].textureFile;
 					ObjTypes[type].texture = new TTexture();
 					ObjTypes[type].texture->Load(terrpath, false);
@@ -590,6 +593,10 @@ bool CCourse::LoadTerrainTypes() {
 		TerrList[i].texture = nullptr;
 		TerrList[i].shiny = SPBoolN(*line, "shiny", false);
 		TerrList[i].vol_type = SPIntN(*line, "vol_type", 1);
+		TerrList[i].track_height = SPFloatN(*line, "trackheight", 0.08f);
+		TerrList[i].max_tracks = std::max(0, SPIntN(*line, "maxtracks", 10000));
+		TerrList[i].part_col = SPColor3N(*line, "partcol", sf::Color::White);
+		TerrList[i].part_rate = SPFloatN(*line, "partrate", 1.f);
 	}
 	return true;
 }
@@ -619,7 +626,7 @@ bool CCourse::LoadTerrainMap() {
 			int arridx = (nx-1-x) + nx * (ny-1-y);
 			int terr = GetTerrain(&data[imgidx]);
 			Fields[arridx].terrain = terr;
-			if (TerrList[terr].texture == nullptr) {
+			if (TerrList[terr].texture == nullptr && !headless) {
 				TerrList[terr].texture = new TTexture();
 				TerrList[terr].texture->Load(param.terr_dir, TerrList[terr].textureFile, true);
 			}
@@ -653,9 +660,11 @@ bool CCourseList::Load(const std::string& dir) {
 		if (DirExists(coursepath.c_str())) {
 			// preview
 			std::string previewfile = coursepath + SEP "preview.png";
-			courses[i].preview = new TTexture();
-			if (!courses[i].preview->Load(previewfile, false)) {
-				Message("couldn't load previewfile");
+			if (!Course.headless) {
+				courses[i].preview = new TTexture();
+				if (!courses[i].preview->Load(previewfile, false)) {
+					Message("couldn't load previewfile");
+				}
 			}
 
 			// params
@@ -727,13 +736,15 @@ CCourseList* CCourse::getGroup(std::size_t index) {
 //  ===================================================================
 
 void CCourse::ResetCourse() {
+	// first of all, as the quadtree update thread may still read the fields
+	ResetQuadtree();
+	ResetTerrainChunks();
 	Fields.clear();
 	delete[] vnc_array;
 	vnc_array = nullptr;
 
 	FreeTerrainTextures();
 	FreeObjectTextures();
-	ResetQuadtree();
 	curr_course = nullptr;
 	mirrored = false;
 }
@@ -757,7 +768,7 @@ bool CCourse::LoadCourse(TCourse* course) {
 		}
 
 		MakeCourseNormals();
-		FillGlArrays();
+		if (!headless) FillGlArrays();
 
 		if (!LoadTerrainMap()) {
 			Message("could not load course terrain map");
@@ -767,7 +778,6 @@ bool CCourse::LoadCourse(TCourse* course) {
 		// ................................................................
 		std::string itemfile = CourseDir + SEP "items.lst";
 		bool itemsexists = FileExists(itemfile);
-		const CControl *ctrl = g_game.player->ctrl;
 
 		if (itemsexists && !g_game.force_treemap)
 			LoadItemList();
@@ -776,13 +786,10 @@ bool CCourse::LoadCourse(TCourse* course) {
 		g_game.force_treemap = false;
 		// ................................................................
 
-		init_track_marks();
-		InitQuadtree(
-		    &Fields[0], nx, ny,
-		    curr_course->size.x / (nx - 1.0),
-		    -curr_course->size.y / (ny - 1.0),
-		    ctrl->viewpos,
-		    param.course_detail_level);
+		if (!headless) {
+			init_track_marks();
+			InitTerrainRenderer();
+		}
 	}
 
 	if (g_game.mirrorred != mirrored) {
@@ -792,6 +799,22 @@ bool CCourse::LoadCourse(TCourse* course) {
 	return true;
 }
 
+void CCourse::InitTerrainRenderer() {
+	ResetQuadtree();
+	ResetTerrainChunks();
+	if (nx == 0 || ny == 0) return;
+
+	double scalex = curr_course->size.x / (nx - 1.0);
+	double scalez = -curr_course->size.y / (ny - 1.0);
+	if (param.terrain_renderer == 1) {
+		InitTerrainChunks(&Fields[0], nx, ny, scalex, scalez);
+	} else {
+		const CControl *ctrl = g_game.player->ctrl;
+		InitQuadtree(&Fields[0], nx, ny, scalex, scalez,
+		             ctrl->viewpos, param.course_detail_level);
+	}
+}
+
 std::size_t CCourse::GetEnv() const {
 	return curr_course->env;
 }
@@ -801,6 +824,7 @@ std::size_t CCourse::GetEnv() const {
 // --------------------------------------------------------------------
 
 void CCourse::MirrorCourseData() {
+	ResetQuadtree();
 	for (unsigned int y = 0; y < ny; y++) {
 		for (unsigned int x = 0; x < nx / 2; x++) {
 			double tmp = ELEV(x,y);
@@ -829,13 +853,9 @@ void CCourse::MirrorCourseData() {
 		NocollArr[i].pt.y = FindYCoord(NocollArr[i].pt.x, NocollArr[i].pt.z);
 	}
 
-	FillGlArrays();
-
-	ResetQuadtree();
-	if (nx > 0 && ny > 0) {
-		const CControl *ctrl = g_game.player->ctrl;
-		InitQuadtree(&Fields[0], nx, ny, curr_course->size.x/(nx-1),
-		             - curr_course->size.y/(ny-1), ctrl->viewpos, param.course_detail_level);
+	if (!headless) {
+		FillGlArrays();
+		InitTerrainRenderer();
 	}
 
 	start_pt.x = curr_course->size.x - start_pt.x;
@@ -843,7 +863,7 @@ void CCourse::MirrorCourseData() {
 
 void CCourse::MirrorCourse() {
 	MirrorCourseData();
-	init_track_marks();
+	if (!headless) init_track_marks();
 }
 
 // ********************************************************************
@@ -954,8 +974,9 @@ TVector3d CCourse::FindCourseNormal(double x, double z) const {
 }
 
 double CCourse::FindYCoord(double x, double z) const {
-	static double last_x, last_z, last_y;
-	static bool cache_full = false;
+	// per thread, as the particles are updated by parallel jobs
+	static thread_local double last_x, last_z, last_y;
+	static thread_local bool cache_full = false;
 
 	if (cache_full && last_x == x && last_z == z) return last_y;
 
@@ -53,6 +53,11 @@ struct TTerrType {
 	int starttex;
 	int tracktex;
 	int stoptex;
+	// track and particle profile
+	float track_height;		// of the marks above the surface
+	std::size_t max_tracks;	// marks kept on this terrain
+	sf::Color part_col;
+	float part_rate;		// factor of the emission rate
 };
 
 struct TObjectType {
@@ -148,7 +153,6 @@ private:
 
 	void		FreeTerrainTextures();
 	void		FreeObjectTextures();
-	void		CalcNormals();
 	void		MakeCourseNormals();
 	bool		LoadElevMap();
 	void		LoadItemList();
@@ -171,6 +175,9 @@ public:
 
 	std::vector<CourseFields>	Fields;
 	GLubyte *vnc_array;
+	// load only the course data, without textures and GL arrays, for
+	// programs without a GL context
+	bool headless;
 
 	CCourseList* getGroup(std::size_t index);
 
@@ -180,11 +187,13 @@ public:
 	void FreeCourseList();
 	bool LoadCourseList();
 	bool LoadCourse(TCourse* course);
+	void InitTerrainRenderer();
 	bool LoadTerrainTypes();
 	bool LoadObjectTypes();
 	void MakeStandardPolyhedrons();
 	GLubyte* GetGLArrays() const { return vnc_array; }
 	void FillGlArrays();
+	void CalcNormals();
 
 	const TVector2d& GetDimensions() const { return curr_course->size; }
 	const TVector2d& GetPlayDimensions() const { return curr_course->play_size; }
@@ -24,13 +24,16 @@ GNU General Public License for more details.
 #include "course.h"
 #include "ogl.h"
 #include "quadtree.h"
+#include "terrain_chunks.h"
 #include "particles.h"
 #include "env.h"
 #include "game_ctrl.h"
 #include "physics.h"
+#include "render_queue.h"
 
 #define TEX_SCALE 6
 static const bool clip_course = true;
+static std::size_t course_triangles = 0;
 
 void setup_course_tex_gen() {
 	static const GLfloat xplane[4] = {1.f / TEX_SCALE, 0.f, 0.f, 0.f };
@@ -45,138 +48,94 @@ void RenderCourse() {
 	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 	set_material(colWhite, colBlack, 1.0);
 	const CControl *ctrl = g_game.player->ctrl;
-	UpdateQuadtree(ctrl->viewpos, param.course_detail_level);
-	RenderQuadtree();
+	if (param.terrain_renderer == 1) {
+		course_triangles = RenderTerrainChunks(ctrl->viewpos, param.course_detail_level);
+	} else {
+		UpdateQuadtree(ctrl->viewpos, param.course_detail_level);
+		course_triangles = RenderQuadtree();
+	}
+}
+
+std::size_t GetCourseTriangles() {
+	return course_triangles;
 }
 
+// The trees and items are submitted to the render queue in world
+// coordinates, they are drawn with the next RenderQueue.Flush().
 void DrawTrees() {
-	std::size_t tree_type = -1;
 	const CControl*	ctrl = g_game.player->ctrl;
 
-	ScopedRenderMode rm(TREES);
 	double fwd_clip_limit = param.forward_clip_distance;
 	double bwd_clip_limit = param.backward_clip_distance;
 
-	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-	set_material(colWhite, colBlack, 1.0);
+	// the trees are turned by 1 degree, as with the former glRotatef
+	double rot = param.perf_level > 1 ? 1.0 * M_PI / 180.0 : 0.0;
+	double rcos = std::cos(rot);
+	double rsin = std::sin(rot);
+	TVector3d tree_normal(rsin, 0, rcos);
 
 	// Trees
 	for (std::size_t i = 0; i< Course.CollArr.size(); i++) {
+		const TCollidable& tree = Course.CollArr[i];
 		if (clip_course) {
-			if (ctrl->viewpos.z - Course.CollArr[i].pt.z > fwd_clip_limit) continue;
-			if (Course.CollArr[i].pt.z - ctrl->viewpos.z > bwd_clip_limit) continue;
+			if (ctrl->viewpos.z - tree.pt.z > fwd_clip_limit) continue;
+			if (tree.pt.z - ctrl->viewpos.z > bwd_clip_limit) continue;
 		}
 
-		if (Course.CollArr[i].tree_type != tree_type) {
-			tree_type = Course.CollArr[i].tree_type;
-			Course.ObjTypes[tree_type].texture->Bind();
-		}
-
-		glPushMatrix();
-		glTranslate(Course.CollArr[i].pt);
-		if (param.perf_level > 1) glRotatef(1, 0, 1, 0);
-
-		float treeRadius = Course.CollArr[i].diam / 2.0;
-		float treeHeight = Course.CollArr[i].height;
-		glNormal3i(0, 0, 1);
-
-		static const GLshort tex[] = {
-			0, 1,
-			1, 1,
-			1, 0,
-			0, 0,
-			0, 1,
-			1, 1,
-			1, 0,
-			0, 0
-		};
-
-		const GLfloat vtx[] = {
-			-treeRadius, 0.0,        0.0,
-			treeRadius,  0.0,        0.0,
-			treeRadius,  treeHeight, 0.0,
-			-treeRadius, treeHeight, 0.0,
-			0.0,         0.0,        -treeRadius,
-			0.0,         0.0,        treeRadius,
-			0.0,         treeHeight, treeRadius,
-			0.0,         treeHeight, -treeRadius
-		};
-
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-
-		glVertexPointer(3, GL_FLOAT, 0, vtx);
-		glTexCoordPointer(2, GL_SHORT, 0, tex);
-		glDrawArrays(GL_QUADS, 0, 8);
-
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		glDisableClientState(GL_VERTEX_ARRAY);
-
-		glPopMatrix();
+		RenderQueue.Begin(TREES, Course.ObjTypes[tree.tree_type].texture);
+		RenderQueue.Normal(tree_normal);
+
+		double treeRadius = tree.diam / 2.0;
+		double treeHeight = tree.height;
+		TVector3d xvec(treeRadius * rcos, 0, -treeRadius * rsin);
+		TVector3d zvec(treeRadius * rsin, 0, treeRadius * rcos);
+		TVector3d top = tree.pt;
+		top.y += treeHeight;
+
+		RenderQueue.Vertex(tree.pt - xvec, 0, 1);
+		RenderQueue.Vertex(tree.pt + xvec, 1, 1);
+		RenderQueue.Vertex(top + xvec, 1, 0);
+		RenderQueue.Vertex(top - xvec, 0, 0);
+
+		RenderQueue.Vertex(tree.pt - zvec, 0, 1);
+		RenderQueue.Vertex(tree.pt + zvec, 1, 1);
+		RenderQueue.Vertex(top + zvec, 1, 0);
+		RenderQueue.Vertex(top - zvec, 0, 0);
+		RenderQueue.End();
 	}
 
 	// Items
-	const TObjectType* item_type = nullptr;
-
 	for (std::size_t i = 0; i< Course.NocollArr.size(); i++) {
-		if (Course.NocollArr[i].collectable == 0 || Course.NocollArr[i].type.drawable == false) continue;
+		const TItem& item = Course.NocollArr[i];
+		if (item.collectable == 0 || item.type.drawable == false) continue;
 		if (clip_course) {
-			if (ctrl->viewpos.z - Course.NocollArr[i].pt.z > fwd_clip_limit) continue;
-			if (Course.NocollArr[i].pt.z - ctrl->viewpos.z > bwd_clip_limit) continue;
+			if (ctrl->viewpos.z - item.pt.z > fwd_clip_limit) continue;
+			if (item.pt.z - ctrl->viewpos.z > bwd_clip_limit) continue;
 		}
 
-		if (&Course.NocollArr[i].type != item_type) {
-			item_type = &Course.NocollArr[i].type;
-			item_type->texture->Bind();
-		}
-
-		glPushMatrix();
-		glTranslate(Course.NocollArr[i].pt);
-		double itemRadius = Course.NocollArr[i].diam / 2;
-		double itemHeight = Course.NocollArr[i].height;
+		RenderQueue.Begin(TREES, item.type.texture);
+		double itemRadius = item.diam / 2;
+		double itemHeight = item.height;
 
 		TVector3d normal;
-		if (item_type->use_normal) {
-			normal = item_type->normal;
+		if (item.type.use_normal) {
+			normal = item.type.normal;
 		} else {
-			normal = ctrl->viewpos - Course.NocollArr[i].pt;
+			normal = ctrl->viewpos - item.pt;
 			normal.Norm();
 		}
-		glNormal3(normal);
+		RenderQueue.Normal(normal);
 		normal.y = 0.0;
 		normal.Norm();
 
-		static const GLshort tex[] = {
-			0, 1,
-			1, 1,
-			1, 0,
-			0, 0
-		};
-
-		const GLfloat vtx[] = {
-			static_cast<GLfloat>(-itemRadius*normal.z),
-			0.f,
-			static_cast<GLfloat>(itemRadius*normal.x),
-
-			static_cast<GLfloat>(itemRadius*normal.z),
-			0.f,
-			static_cast<GLfloat>(-itemRadius*normal.x),
-			static_cast<GLfloat>(itemRadius*normal.z),
-			static_cast<GLfloat>(itemHeight),
-			static_cast<GLfloat>(-itemRadius*normal.x),
-			static_cast<GLfloat>(-itemRadius*normal.z),
-			static_cast<GLfloat>(itemHeight),
-			static_cast<GLfloat>(itemRadius*normal.x)
-		};
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-
-		glVertexPointer(3, GL_FLOAT, 0, vtx);
-		glTexCoordPointer(2, GL_SHORT, 0, tex);
-		glDrawArrays(GL_QUADS, 0, 4);
-
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		glDisableClientState(GL_VERTEX_ARRAY);
-		glPopMatrix();
+		TVector3d side(-itemRadius*normal.z, 0, itemRadius*normal.x);
+		TVector3d top = item.pt;
+		top.y += itemHeight;
+
+		RenderQueue.Vertex(item.pt + side, 0, 1);
+		RenderQueue.Vertex(item.pt - side, 1, 1);
+		RenderQueue.Vertex(top - side, 1, 0);
+		RenderQueue.Vertex(top + side, 0, 0);
+		RenderQueue.End();
 	}
 }
@@ -23,6 +23,7 @@ GNU General Public License for more details.
 void setup_course_tex_gen();
 
 void RenderCourse();
+std::size_t GetCourseTriangles();	// triangles of the last RenderCourse
 void DrawTrees();
 
 #endif
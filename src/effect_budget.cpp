@@ -0,0 +1,86 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "effect_budget.h"
+#include "game_config.h"
+#include <algorithm>
+
+#define BUDGET_INTERVAL 0.25f	// seconds between two adjustments
+#define BUDGET_SLOW 1.1f	// frames longer than target * BUDGET_SLOW reduce the effects
+#define BUDGET_FAST 0.9f	// frames shorter than target * BUDGET_FAST let them grow
+#define BUDGET_REDUCE 0.4f	// reduction of an effect that has all the cost
+#define BUDGET_GROW 0.05f
+#define BUDGET_MIN_SCALE 0.05f	// smaller scales switch the effect off
+
+CEffectBudget EffectBudget;
+
+CEffectBudget::CEffectBudget() {
+	std::fill(scale, scale + NUM_EFFECTS, 1.f);
+	std::fill(cost, cost + NUM_EFFECTS, 0.f);
+	ceiling = 1.f;
+	interval_time = 0.f;
+	interval_busy = 0.f;
+	interval_frames = 0;
+}
+
+// Called at the start of a race. The detail level sets the ceiling, the
+// effects start at it.
+void CEffectBudget::Reset() {
+	ceiling = clamp(0.25f, param.perf_level * 0.25f, 1.f);
+	std::fill(scale, scale + NUM_EFFECTS, ceiling);
+	std::fill(cost, cost + NUM_EFFECTS, 0.f);
+	interval_time = 0.f;
+	interval_busy = 0.f;
+	interval_frames = 0;
+}
+
+void CEffectBudget::EndFrame(float frame_time, float busy_time) {
+	interval_time += frame_time;
+	interval_busy += busy_time;
+	interval_frames++;
+	if (interval_time < BUDGET_INTERVAL)
+		return;
+
+	float target = 1.f / (param.framerate > 0 ? param.framerate : 60);
+	float average = interval_busy / interval_frames;
+	float total = 0.f;
+	for (int i = 0; i < NUM_EFFECTS; i++)
+		total += cost[i];
+
+	if (average > target * BUDGET_SLOW && total > 0.f) {
+		for (int i = 0; i < NUM_EFFECTS; i++) {
+			scale[i] *= 1.f - BUDGET_REDUCE * cost[i] / total;
+			if (scale[i] < BUDGET_MIN_SCALE) scale[i] = 0.f;
+		}
+	} else if (average < target * BUDGET_FAST) {
+		for (int i = 0; i < NUM_EFFECTS; i++)
+			scale[i] = std::min(scale[i] + BUDGET_GROW, ceiling);
+	}
+
+	std::fill(cost, cost + NUM_EFFECTS, 0.f);
+	interval_time = 0.f;
+	interval_busy = 0.f;
+	interval_frames = 0;
+}
+
+CEffectBudget::Timer::~Timer() {
+	EffectBudget.AddCost(effect, clock.getElapsedTime().asSeconds());
+}
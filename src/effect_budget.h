@@ -0,0 +1,71 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+/* --------------------------------------------------------------------
+The effect budget scales the amount of snow effects so that a race
+holds the configured frame rate. The time each effect costs on the main
+thread is measured, and when the frames get too long the most expensive
+effects are reduced first. With headroom they grow back up to the
+ceiling given by the detail level.
+--------------------------------------------------------------------- */
+
+#ifndef EFFECT_BUDGET_H
+#define EFFECT_BUDGET_H
+
+#include "bh.h"
+
+enum TEffect {
+	EFFECT_PARTICLES,
+	EFFECT_FLAKES,
+	EFFECT_CURTAINS,
+	EFFECT_TRACKS,
+	NUM_EFFECTS
+};
+
+class CEffectBudget {
+private:
+	float scale[NUM_EFFECTS];
+	float cost[NUM_EFFECTS];	// seconds in the current interval
+	float ceiling;
+	float interval_time;
+	float interval_busy;
+	std::size_t interval_frames;
+public:
+	CEffectBudget();
+
+	void Reset();
+	void AddCost(TEffect effect, float seconds) { cost[effect] += seconds; }
+	// busy_time is the frame time without the wait of the frame pacer
+	void EndFrame(float frame_time, float busy_time);
+
+	// 0 = effect disabled, 1 = full density
+	float Scale(TEffect effect) const { return scale[effect]; }
+	bool Enabled(TEffect effect) const { return scale[effect] > 0.f; }
+
+	// measures the lifetime of the object as cost of an effect
+	class Timer {
+		TEffect effect;
+		sf::Clock clock;
+	public:
+		explicit Timer(TEffect e) : effect(e) {}
+		~Timer();
+	};
+};
+
+extern CEffectBudget EffectBudget;
+
+#endif
@@ -233,6 +233,7 @@ void CEnvironment::DrawSkybox(const TVector3d& pos) const {
 	Skybox[0].Bind();
 	glVertexPointer(3, GL_SHORT, 0, front);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	num_draw_calls++;
 
 	// left
 	static const GLshort left[] = {
@@ -244,6 +245,7 @@ void CEnvironment::DrawSkybox(const TVector3d& pos) const {
 	Skybox[1].Bind();
 	glVertexPointer(3, GL_SHORT, 0, left);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	num_draw_calls++;
 
 	// right
 	static const GLshort right[] = {
@@ -255,6 +257,7 @@ void CEnvironment::DrawSkybox(const TVector3d& pos) const {
 	Skybox[2].Bind();
 	glVertexPointer(3, GL_SHORT, 0, right);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	num_draw_calls++;
 
 	// normally, the following textures are unvisible
 	// see game_config.cpp (param.full_skybox)
@@ -269,6 +272,7 @@ void CEnvironment::DrawSkybox(const TVector3d& pos) const {
 		Skybox[3].Bind();
 		glVertexPointer(3, GL_SHORT, 0, top);
 		glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+		num_draw_calls++;
 
 		// bottom
 		static const GLshort bottom[] = {
@@ -280,6 +284,7 @@ void CEnvironment::DrawSkybox(const TVector3d& pos) const {
 		Skybox[4].Bind();
 		glVertexPointer(3, GL_SHORT, 0, bottom);
 		glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+		num_draw_calls++;
 
 		// back
 		static const GLshort back[] = {
@@ -291,6 +296,7 @@ void CEnvironment::DrawSkybox(const TVector3d& pos) const {
 		Skybox[5].Bind();
 		glVertexPointer(3, GL_SHORT, 0, back);
 		glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+		num_draw_calls++;
 	}
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	glDisableClientState(GL_VERTEX_ARRAY);
@@ -371,6 +377,7 @@ void CEnvironment::DrawFog() const {
 	vpoint = topright + 3.0 * rightvec;
 	glVertex3(vpoint);
 	glEnd();
+	num_draw_calls++;
 }
 
 
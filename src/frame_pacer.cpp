@@ -0,0 +1,144 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "frame_pacer.h"
+#include "game_config.h"
+#include "winsys.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#define PACER_MIN_SPIN 0.0005f	// s
+#define PACER_MAX_SPIN 0.004f
+#define PACER_POLL_SLICE 0.002f	// s of sleep between the polls
+#define PACER_LATE 1.1f			// relative frame time of a late frame
+#define ADAPT_INTERVAL 1.f		// s between the vsync decisions
+#define ADAPT_OFF 0.1f			// part of late frames that switches vsync off
+
+CFramePacer FramePacer;
+
+CFramePacer::CFramePacer() {
+	Reset();
+}
+
+void CFramePacer::Reset() {
+	clock.restart();
+	deadline = sf::Time::Zero;
+	last = sf::Time::Zero;
+	spin_time = 0.002f;
+	wait_time = 0.f;
+	history_count = 0;
+	history_pos = 0;
+	adapt_time = 0.f;
+	adapt_frames = 0;
+	adapt_late = 0;
+}
+
+void CFramePacer::Wait(const std::function<void()>& poll) {
+	float target = param.framerate > 0 ? 1.f / param.framerate : 0.f;
+	sf::Time start = clock.getElapsedTime();
+
+	if (target > 0.f) {
+		sf::Time wake = deadline - sf::seconds(spin_time);
+		float left = (wake - clock.getElapsedTime()).asSeconds();
+		while (left > 0.f) {
+			bool last_slice = left <= PACER_POLL_SLICE;
+			sf::sleep(sf::seconds(std::min(left, PACER_POLL_SLICE)));
+			if (last_slice) {
+				// move the spin time towards the oversleeping, with some margin
+				float over = (clock.getElapsedTime() - wake).asSeconds();
+				spin_time += 0.1f * (1.5f * over - spin_time);
+				spin_time = clamp(PACER_MIN_SPIN, spin_time, PACER_MAX_SPIN);
+				break;
+			}
+			poll();
+			left = (wake - clock.getElapsedTime()).asSeconds();
+		}
+		while (clock.getElapsedTime() < deadline)
+			std::this_thread::yield();
+
+		sf::Time end = clock.getElapsedTime();
+		deadline += sf::seconds(target);
+		// after a late frame the next one gets a full frame time
+		if (deadline < end)
+			deadline = end + sf::seconds(target);
+	}
+
+	sf::Time now = clock.getElapsedTime();
+	wait_time = (now - start).asSeconds();
+	float frame_time = (now - last).asSeconds();
+	last = now;
+	history[history_pos] = frame_time;
+	history_pos = (history_pos + 1) % PACER_HISTORY;
+	history_count = std::min(history_count + 1, (std::size_t)PACER_HISTORY);
+
+	if (param.vsync == 2)
+		AdaptVerticalSync(frame_time, target > 0.f ? target : 1.f / 60);
+}
+
+void CFramePacer::AdaptVerticalSync(float frame_time, float target) {
+	adapt_time += frame_time;
+	adapt_frames++;
+	if (frame_time > target * PACER_LATE)
+		adapt_late++;
+	if (adapt_time < ADAPT_INTERVAL)
+		return;
+
+	bool late = adapt_late > adapt_frames * ADAPT_OFF;
+	if (late && Winsys.VerticalSync())
+		Winsys.SetVerticalSync(false);
+	else if (adapt_late == 0 && !Winsys.VerticalSync())
+		Winsys.SetVerticalSync(true);
+
+	adapt_time = 0.f;
+	adapt_frames = 0;
+	adapt_late = 0;
+}
+
+TPacerStats CFramePacer::Stats() const {
+	TPacerStats stats;
+	stats.target = param.framerate > 0 ? 1000.f / param.framerate : 0.f;
+	stats.spin = spin_time * 1000.f;
+	stats.frames = history_count;
+	stats.mean = stats.jitter = stats.max_dev = 0.f;
+	stats.late = 0;
+	if (history_count == 0)
+		return stats;
+
+	float sum = 0.f;
+	for (std::size_t i = 0; i < history_count; i++)
+		sum += history[i];
+	float mean = sum / history_count;
+	float var = 0.f;
+	float max_dev = 0.f;
+	float late = (stats.target > 0.f ? stats.target : 1000.f / 60) * PACER_LATE / 1000.f;
+	for (std::size_t i = 0; i < history_count; i++) {
+		float dev = history[i] - mean;
+		var += dev * dev;
+		max_dev = std::max(max_dev, std::fabs(dev));
+		if (history[i] > late)
+			stats.late++;
+	}
+	stats.mean = mean * 1000.f;
+	stats.jitter = std::sqrt(var / history_count) * 1000.f;
+	stats.max_dev = max_dev * 1000.f;
+	return stats;
+}
@@ -0,0 +1,75 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+/* --------------------------------------------------------------------
+Frame pacing. At the end of each frame the pacer waits for the deadline
+of the next one, given by param.framerate: it sleeps until shortly
+before the deadline and spins for the rest, the spin time follows the
+measured oversleeping of the system. Late frames do not shift the later
+deadlines. With adaptive vsync the pacer switches the vertical sync off
+while the frames miss the framerate and on again when they keep it.
+--------------------------------------------------------------------- */
+
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include "bh.h"
+#include <functional>
+
+#define PACER_HISTORY 256	// frames of the jitter statistics
+
+struct TPacerStats {
+	float target;		// ms, 0 if unlimited
+	float mean;			// ms
+	float jitter;		// standard deviation of the frame time, ms
+	float max_dev;		// largest deviation from the mean, ms
+	float spin;			// current spin time, ms
+	std::size_t late;	// frames longer than the target
+	std::size_t frames;
+};
+
+class CFramePacer {
+private:
+	sf::Clock clock;	// monotonic
+	sf::Time deadline;
+	sf::Time last;
+	float spin_time;	// s, time left for spinning after the sleep
+	float wait_time;	// s, sleep and spin of the last wait
+
+	float history[PACER_HISTORY];	// s
+	std::size_t history_count;
+	std::size_t history_pos;
+
+	float adapt_time;
+	std::size_t adapt_frames;
+	std::size_t adapt_late;
+
+	void AdaptVerticalSync(float frame_time, float target);
+public:
+	CFramePacer();
+
+	void Reset();
+	// waits for the deadline of the next frame and records the frame time,
+	// poll is called between the parts of the sleep
+	void Wait(const std::function<void()>& poll);
+	float LastWait() const { return wait_time; }
+	TPacerStats Stats() const;
+};
+
+extern CFramePacer FramePacer;
+
+#endif
@@ -64,6 +64,7 @@ void LoadConfigFile() {
 		param.music_volume = SPIntN(*line, "music_volume", 20);
 
 		param.framerate = SPIntN(*line, "framerate", 60);
+		param.vsync = SPIntN(*line, "vsync", 0);
 
 		param.forward_clip_distance = SPIntN(*line, "forward_clip_distance", 75);
 		param.backward_clip_distance = SPIntN(*line, "backward_clip_distance", 20);
@@ -73,6 +74,13 @@ void LoadConfigFile() {
 		param.tux_sphere_divisions = SPIntN(*line, "tux_sphere_divisions", 10);
 		param.tux_shadow_sphere_divisions = SPIntN(*line, "tux_shadow_sphere_div", 3);
 		param.course_detail_level = SPIntN(*line, "course_detail_level", 75);
+		param.terrain_renderer = SPIntN(*line, "terrain_renderer", 0);
+		param.threaded_quadtree = SPBoolN(*line, "threaded_quadtree", false);
+		param.threaded_physics = SPBoolN(*line, "threaded_physics", false);
+		param.record_races = SPBoolN(*line, "record_races", false);
+		param.show_ghost = SPBoolN(*line, "show_ghost", true);
+		param.telemetry = SPIntN(*line, "telemetry", 0);
+		param.random_seed = SPIntN(*line, "random_seed", 0);
 
 		param.use_papercut_font = SPIntN(*line, "use_papercut_font", 1);
 		param.ice_cursor = SPIntN(*line, "ice_cursor", 1) != 0;
@@ -96,6 +104,7 @@ void SetConfigDefaults() {
 	// ---------------------------------------
 
 	param.framerate = 60;
+	param.vsync = 0;
 
 	param.forward_clip_distance = 75;
 	param.backward_clip_distance = 20;
@@ -105,6 +114,13 @@ void SetConfigDefaults() {
 	param.tux_sphere_divisions = 10;
 	param.tux_shadow_sphere_divisions = 3;
 	param.course_detail_level = 75;
+	param.terrain_renderer = 0;
+	param.threaded_quadtree = false;
+	param.threaded_physics = false;
+	param.record_races = false;
+	param.show_ghost = true;
+	param.telemetry = 0;
+	param.random_seed = 0;
 
 	param.use_papercut_font = 1;
 	param.ice_cursor = true;
@@ -178,6 +194,12 @@ void SaveConfigFile() {
 	AddItem(liste, "framerate", param.framerate);
 	liste.Add();
 
+	AddComment(liste, "Vertical synchronisation [0...2]");
+	AddComment(liste, "0 = off, 1 = on, 2 = adaptive: off while the frames");
+	AddComment(liste, "miss the framerate, on when they keep it");
+	AddItem(liste, "vsync", param.vsync);
+	liste.Add();
+
 	AddComment(liste, "Forward clipping distance");
 	AddComment(liste, "Controls how far ahead of the camera the course");
 	AddComment(liste, "is rendered. Larger values mean that more of the course is");
@@ -220,11 +242,46 @@ void SaveConfigFile() {
 	liste.Add();
 
 	AddComment(liste, "Detail level of the course");
-	AddComment(liste, "This param is used for the quadtree and controls the");
-	AddComment(liste, "LOD of the algorithm. ");
+	AddComment(liste, "This param controls the LOD of the course renderer");
+	AddComment(liste, "(quadtree or chunked LOD).");
 	AddItem(liste, "course_detail_level", param.course_detail_level);
 	liste.Add();
 
+	AddComment(liste, "Course renderer [0...1]");
+	AddComment(liste, "0 = quadtree, 1 = chunked LOD with fixed-size patches");
+	AddItem(liste, "terrain_renderer", param.terrain_renderer);
+	liste.Add();
+
+	AddComment(liste, "Update the quadtree course on a separate thread [0...1]");
+	AddComment(liste, "The renderer then draws the mesh of the last finished update");
+	AddItem(liste, "threaded_quadtree", param.threaded_quadtree);
+	liste.Add();
+
+	AddComment(liste, "Run the race physics on a separate thread [0...1]");
+	AddComment(liste, "The renderer then draws the last finished physics step");
+	AddItem(liste, "threaded_physics", param.threaded_physics);
+	liste.Add();
+
+	AddComment(liste, "Record each race to a replay file in the save directory [0...1]");
+	AddComment(liste, "Watch it with --replay <file>, or check it with --replay-headless <file>");
+	AddItem(liste, "record_races", param.record_races);
+	liste.Add();
+
+	AddComment(liste, "Show the best run of the course as a ghost [0...1]");
+	AddItem(liste, "show_ghost", param.show_ghost);
+	liste.Add();
+
+	AddComment(liste, "Runtime counters, written once a second [0...2]");
+	AddComment(liste, "0 = off, 1 = telemetry.txt, 2 = local socket telemetry.sock,");
+	AddComment(liste, "both in the save directory");
+	AddItem(liste, "telemetry", param.telemetry);
+	liste.Add();
+
+	AddComment(liste, "Seed of the particle, weather and tree generators");
+	AddComment(liste, "0 = new seed at each start, other values make them reproducible");
+	AddItem(liste, "random_seed", param.random_seed);
+	liste.Add();
+
 	AddComment(liste, "Font type [0...2]");
 	AddComment(liste, "0 = always arial-like font,");
 	AddComment(liste, "1 = papercut font on the menu screens");
@@ -42,6 +42,7 @@ struct TParam {
 	// main config params:
 	std::size_t	res_type;
 	uint32_t	framerate;
+	int			vsync;		// 0 = off, 1 = on, 2 = adaptive
 	int			perf_level;
 	std::size_t	language;
 	int			sound_volume;
@@ -54,7 +55,14 @@ struct TParam {
 	int		tree_detail_distance;
 	int		tux_sphere_divisions;
 	int		tux_shadow_sphere_divisions;
-	int		course_detail_level; // only for quadtree
+	int		course_detail_level; // lod of the course renderer
+	int		terrain_renderer;	// 0 = quadtree, 1 = chunked lod
+	bool	threaded_quadtree;	// update the quadtree on a worker thread
+	bool	threaded_physics;	// run the race physics on its own thread
+	bool	record_races;		// write a replay of each race
+	bool	show_ghost;			// race against the best run of the course
+	int		telemetry;			// 0 = off, 1 = file, 2 = local socket
+	uint32_t	random_seed;	// 0 = seed from the clock
 
 	int		use_papercut_font;
 	bool	ice_cursor;
@@ -39,6 +39,8 @@ GNU General Public License for more details.
 #include "winsys.h"
 #include "physics.h"
 #include "tux.h"
+#include "render_queue.h"
+#include "replay.h"
 
 CGameOver GameOver;
 
@@ -144,7 +146,9 @@ void GameOverMessage(const CControl *ctrl) {
 
 // =========================================================================
 void CGameOver::Enter() {
-	if (!g_game.raceaborted) highscore_pos = Score.CalcRaceResult();
+	// a replay neither files a score nor replaces the ghost
+	highscore_pos = MAX_SCORES;
+	if (!g_game.raceaborted && !Replay.Played()) highscore_pos = Score.CalcRaceResult();
 
 	if (g_game.game_type == CUPRACING) {
 		if (g_game.race_result >= 0) {
@@ -199,10 +203,12 @@ void CGameOver::Loop(float time_step) {
 	RenderCourse();
 	DrawTrackmarks();
 	DrawTrees();
+	RenderQueue.Flush();
 
 	UpdateWind(time_step);
 	UpdateSnow(time_step, ctrl);
 	DrawSnow(ctrl);
+	RenderQueue.Flush();
 
 	g_game.character->shape->Draw();
 
@@ -0,0 +1,213 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "ghost.h"
+#include "game_ctrl.h"
+#include "physics.h"
+#include "tux.h"
+#include <fstream>
+#include <cmath>
+
+#define GHOST_MAGIC "ETRG"
+#define GHOST_VERSION 1
+
+CGhost Ghost;
+
+static const TCharMaterial ghost_mat = { sf::Color(200, 220, 255, 90), colBlack, 0.0 };
+
+static std::string GhostFile(const std::string& group, const std::string& course) {
+	return param.config_dir + SEP "ghost_" + group + '_' + course;
+}
+
+static int16_t Quantize16(double value, double scale) {
+	return (int16_t)clamp(-32767.0, std::floor(value * scale + 0.5), 32767.0);
+}
+
+static int8_t Quantize8(double value) {
+	return (int8_t)clamp(-127.0, std::floor(value * 127.0 + 0.5), 127.0);
+}
+
+// --------------------------------------------------------------------
+//				CGhostTrack
+// --------------------------------------------------------------------
+
+void CGhostTrack::Clear() {
+	samples.clear();
+	mirror = false;
+	for (int i = 0; i < 3; i++)
+		origin[i] = last[i] = 0;
+}
+
+// The deltas are taken from the quantized last position, so the rounding
+// errors don't add up.
+void CGhostTrack::Add(const CControl *ctrl) {
+	const double cm[3] = { ctrl->cpos.x * 100.0, ctrl->cpos.y * 100.0, ctrl->cpos.z * 100.0 };
+	if (samples.empty()) {
+		for (int i = 0; i < 3; i++)
+			origin[i] = last[i] = (int32_t)std::floor(cm[i] + 0.5);
+	}
+	int16_t delta[3];
+	for (int i = 0; i < 3; i++) {
+		delta[i] = Quantize16(cm[i] - last[i], 1.0);
+		last[i] += delta[i];
+	}
+
+	TGhostSample sample;
+	sample.dx = delta[0];
+	sample.dy = delta[1];
+	sample.dz = delta[2];
+	sample.rot[0] = Quantize16(ctrl->corientation.x, 32767.0);
+	sample.rot[1] = Quantize16(ctrl->corientation.y, 32767.0);
+	sample.rot[2] = Quantize16(ctrl->corientation.z, 32767.0);
+	sample.rot[3] = Quantize16(ctrl->corientation.w, 32767.0);
+	sample.turn = Quantize8(ctrl->turn_animation);
+	sample.roll = Quantize8(ctrl->roll_factor);
+	sample.flip = Quantize8(ctrl->flip_factor);
+	sample.braking = ctrl->is_braking;
+	samples.push_back(sample);
+}
+
+// The samples are written in the byte order of the machine.
+bool CGhostTrack::Save(const std::string& path) const {
+	std::ofstream file(path.c_str(), std::ios::binary);
+	if (!file) return false;
+
+	uint32_t header[2] = { GHOST_VERSION, (uint32_t)samples.size() };
+	uint8_t mirrored = mirror;
+	file.write(GHOST_MAGIC, 4);
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(&mirrored), 1);
+	file.write(reinterpret_cast<const char*>(origin), sizeof(origin));
+	if (!samples.empty())
+		file.write(reinterpret_cast<const char*>(&samples[0]), samples.size() * sizeof(TGhostSample));
+	return (bool)file;
+}
+
+bool CGhostTrack::Load(const std::string& path) {
+	Clear();
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file) return false;
+
+	char magic[4];
+	uint32_t header[2];
+	uint8_t mirrored;
+	if (!file.read(magic, 4) || std::string(magic, 4) != GHOST_MAGIC ||
+	        !file.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+	        header[0] != GHOST_VERSION || header[1] > GHOST_MAX_SAMPLES ||
+	        !file.read(reinterpret_cast<char*>(&mirrored), 1) ||
+	        !file.read(reinterpret_cast<char*>(origin), sizeof(origin))) {
+		Message("could not read the ghost", path);
+		return false;
+	}
+	samples.resize(header[1]);
+	if (!samples.empty() &&
+	        !file.read(reinterpret_cast<char*>(&samples[0]), samples.size() * sizeof(TGhostSample))) {
+		Message("could not read the ghost", path);
+		samples.clear();
+		return false;
+	}
+	mirror = mirrored != 0;
+	return true;
+}
+
+// --------------------------------------------------------------------
+//				CGhost
+// --------------------------------------------------------------------
+
+void CGhost::StartRace(const std::string& group, const std::string& course) {
+	recording.Clear();
+	recording.mirror = g_game.mirrorred;
+	next_sample = 0.f;
+
+	std::string path = GhostFile(group, course);
+	active = param.show_ghost && FileExists(path) && track.Load(path) &&
+	         track.mirror == g_game.mirrorred && track.samples.size() >= 2;
+	Rewind();
+}
+
+void CGhost::Record(const CControl *ctrl, float time) {
+	if (!ctrl->orientation_initialized) return;
+	// after a reset the time jumps, the gap is filled with the new position
+	while (time >= next_sample && recording.samples.size() < GHOST_MAX_SAMPLES) {
+		recording.Add(ctrl);
+		next_sample += GHOST_INTERVAL;
+	}
+}
+
+void CGhost::SaveBest(const std::string& group, const std::string& course) {
+	if (recording.samples.size() < 2) return;
+	std::string path = GhostFile(group, course);
+	if (!recording.Save(path))
+		Message("could not save the ghost", path);
+}
+
+void CGhost::Rewind() {
+	cursor = 0;
+	for (int i = 0; i < 3; i++) pos[i] = track.origin[i];
+	if (!track.samples.empty()) {
+		pos[0] += track.samples[0].dx;
+		pos[1] += track.samples[0].dy;
+		pos[2] += track.samples[0].dz;
+	}
+}
+
+void CGhost::Seek(std::size_t sample) {
+	if (sample < cursor) Rewind();
+	while (cursor < sample) {
+		const TGhostSample& next = track.samples[++cursor];
+		pos[0] += next.dx;
+		pos[1] += next.dy;
+		pos[2] += next.dz;
+	}
+}
+
+// The pose of the player's shape is saved, replaced by the pose of the
+// ghost for drawing and restored.
+void CGhost::Draw(float time, CCharShape *shape) {
+	if (!active || time < 0.f) return;
+
+	std::size_t last = track.samples.size() - 1;
+	float f = time / GHOST_INTERVAL;
+	std::size_t i = std::min((std::size_t)f, last - 1);
+	float t = std::min(f - i, 1.f);	// the ghost stays at its last sample
+	Seek(i);
+
+	const TGhostSample& s0 = track.samples[i];
+	const TGhostSample& s1 = track.samples[i + 1];
+	TVector3d p0(pos[0], pos[1], pos[2]);
+	TVector3d p1(pos[0] + s1.dx, pos[1] + s1.dy, pos[2] + s1.dz);
+	TVector3d position = 0.01 * (p0 + (double)t * (p1 - p0));
+	position.y += TUX_Y_CORR;
+
+	TQuaternion q0(s0.rot[0], s0.rot[1], s0.rot[2], s0.rot[3]);
+	TQuaternion q1(s1.rot[0], s1.rot[1], s1.rot[2], s1.rot[3]);
+	TQuaternion orientation = InterpolateQuaternions(q0, q1, t);
+	orientation.Norm();
+	double turn = (s0.turn + t * (s1.turn - s0.turn)) / 127.0;
+	double roll = (s0.roll + t * (s1.roll - s0.roll)) / 127.0;
+	double flip = (s0.flip + t * (s1.flip - s0.flip)) / 127.0;
+
+	shape->GetTransforms(saved, saved_inv);
+	shape->PlaceRoot(position, orientation, roll, flip);
+	shape->AdjustJoints(turn, s0.braking != 0, 0.0, 0.0, TVector3d(0, 0, 0), 0.0);
+	shape->DrawGhost(ghost_mat);
+	shape->SetTransforms(saved, saved_inv);
+}
@@ -0,0 +1,94 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+/* --------------------------------------------------------------------
+Ghost racers. The trajectory of each race is sampled at a fixed rate,
+the positions as centimetre deltas from the previous sample and the
+orientation and pose as small integers. When a race sets a new best
+score, CScore stores its trajectory next to the highscores, and the
+following races of the course show it as a ghost. The ghost runs no
+physics: its samples are interpolated and drawn with the shape and the
+sphere meshes of the player, and a trajectory has a bounded length.
+--------------------------------------------------------------------- */
+
+#ifndef GHOST_H
+#define GHOST_H
+
+#include "bh.h"
+#include <vector>
+
+class CCharShape;
+
+#define GHOST_INTERVAL 0.05f		// s between the samples
+#define GHOST_MAX_SAMPLES 12000		// 10 minutes, 216 kB
+
+struct TGhostSample {
+	int16_t dx, dy, dz;		// cm from the previous sample
+	int16_t rot[4];			// orientation, scaled by 32767
+	int8_t turn;			// turn animation, roll and flip factor, scaled by 127
+	int8_t roll;
+	int8_t flip;
+	uint8_t braking;
+};
+
+class CGhostTrack {
+private:
+	int32_t last[3];	// position of the last sample in cm
+public:
+	bool mirror;
+	int32_t origin[3];	// position before the first sample in cm
+	std::vector<TGhostSample> samples;
+
+	CGhostTrack() { Clear(); }
+	void Clear();
+	void Add(const CControl *ctrl);
+	bool Save(const std::string& path) const;
+	bool Load(const std::string& path);
+};
+
+class CGhost {
+private:
+	CGhostTrack recording;	// of the current race
+	CGhostTrack track;		// of the ghost
+	bool active;
+	float next_sample;
+
+	// position of the sample at the cursor, advanced as the race goes on
+	std::size_t cursor;
+	int32_t pos[3];
+
+	// the pose of the player while the ghost is drawn
+	std::vector<TMatrix<4, 4> > saved;
+	std::vector<TMatrix<4, 4> > saved_inv;
+
+	void Rewind();
+	void Seek(std::size_t sample);
+public:
+	CGhost() : active(false), next_sample(0.f), cursor(0) {}
+
+	// loads the ghost of the course and starts the recording
+	void StartRace(const std::string& group, const std::string& course);
+	// called after each step of the race
+	void Record(const CControl *ctrl, float time);
+	void Draw(float time, CCharShape *shape);
+	// the recorded race becomes the ghost of the course
+	void SaveBest(const std::string& group, const std::string& course);
+};
+
+extern CGhost Ghost;
+
+#endif
@@ -125,6 +125,7 @@ void draw_partial_tri_fan(double fraction) {
 	}
 
 	glEnd();
+	num_draw_calls++;
 }
 
 void draw_gauge(double speed, double energy) {
@@ -163,10 +164,12 @@ void draw_gauge(double speed, double energy) {
 	glColor4ubv(energy_background_color);
 	glVertexPointer(2, GL_FLOAT, 0, vtx1);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	num_draw_calls++;
 
 	glColor4ubv(energy_foreground_color);
 	glVertexPointer(2, GL_FLOAT, 0, vtx2);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	num_draw_calls++;
 
 	glDisableClientState(GL_VERTEX_ARRAY);
 
@@ -209,6 +212,7 @@ void draw_gauge(double speed, double energy) {
 
 	glVertexPointer(2, GL_SHORT, 0, vtx3);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	num_draw_calls++;
 
 	glDisableClientState(GL_VERTEX_ARRAY);
 	glPopMatrix();
@@ -261,6 +265,7 @@ void DrawWind(float dir, float speed, const CControl *ctrl) {
 	};
 	glVertexPointer(2, GL_SHORT, 0, vtx1);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	num_draw_calls++;
 
 	// direction indicator
 	float dir_angle = RADIANS_TO_ANGLES(std::atan2(ctrl->cvel.x, ctrl->cvel.z));
@@ -275,6 +280,7 @@ void DrawWind(float dir, float speed, const CControl *ctrl) {
 	};
 	glVertexPointer(2, GL_SHORT, 0, vtx2);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	num_draw_calls++;
 	glDisableClientState(GL_VERTEX_ARRAY);
 	glPopMatrix();
 
@@ -348,6 +354,7 @@ void DrawPercentBar(float fact, float x, float y) {
 	glVertexPointer(2, GL_FLOAT, 0, vtx);
 	glTexCoordPointer(2, GL_FLOAT, 0, tex);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	num_draw_calls++;
 
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	glDisableClientState(GL_VERTEX_ARRAY);
@@ -362,7 +369,9 @@ void DrawCoursePosition(const CControl *ctrl) {
 }
 
 // -------------------------------------------------------
-void DrawHud(const CControl *ctrl) {
+// time and herring are passed separately, as with the physics on its own
+// thread the racing state draws the values of the last snapshot
+void DrawHud(const CControl *ctrl, double time, int herring) {
 	if (!param.show_hud)
 		return;
 
@@ -373,26 +382,26 @@ void DrawHud(const CControl *ctrl) {
 	ScopedRenderMode rm(TEXFONT);
 
 	if (g_game.game_type == CUPRACING) {
-		if (g_game.time < g_game.race->time.z)
-			draw_time(g_game.race->time.z - g_game.time, colGold);
-		else if (g_game.time < g_game.race->time.y)
-			draw_time(g_game.race->time.y - g_game.time, colSilver);
-		else if (g_game.time < g_game.race->time.x)
-			draw_time(g_game.race->time.x - g_game.time, colBronze);
+		if (time < g_game.race->time.z)
+			draw_time(g_game.race->time.z - time, colGold);
+		else if (time < g_game.race->time.y)
+			draw_time(g_game.race->time.y - time, colSilver);
+		else if (time < g_game.race->time.x)
+			draw_time(g_game.race->time.x - time, colBronze);
 		else
-			draw_time(g_game.time, colDRed);
-
-		if (g_game.herring < g_game.race->herrings.x)
-			draw_herring_count(g_game.race->herrings.x - g_game.herring, colBronze);
-		else if (g_game.herring < g_game.race->herrings.y)
-			draw_herring_count(g_game.race->herrings.y - g_game.herring, colSilver);
-		else if (g_game.herring < g_game.race->herrings.z)
-			draw_herring_count(g_game.race->herrings.z - g_game.herring, colGold);
+			draw_time(time, colDRed);
+
+		if (herring < g_game.race->herrings.x)
+			draw_herring_count(g_game.race->herrings.x - herring, colBronze);
+		else if (herring < g_game.race->herrings.y)
+			draw_herring_count(g_game.race->herrings.y - herring, colSilver);
+		else if (herring < g_game.race->herrings.z)
+			draw_herring_count(g_game.race->herrings.z - herring, colGold);
 		else
-			draw_herring_count(g_game.herring, colGreen);
+			draw_herring_count(herring, colGreen);
 	} else {
-		draw_time(g_game.time, param.use_papercut_font < 2 ? colWhite : colDYell);
-		draw_herring_count(g_game.herring, param.use_papercut_font < 2 ? colWhite : colDYell);
+		draw_time(time, param.use_papercut_font < 2 ? colWhite : colDYell);
+		draw_herring_count(herring, param.use_papercut_font < 2 ? colWhite : colDYell);
 	}
 
 	DrawSpeed(speed * 3.6);
@@ -400,3 +409,7 @@ void DrawHud(const CControl *ctrl) {
 	DrawCoursePosition(ctrl);
 	DrawWind(Wind.Angle(), Wind.Speed(), ctrl);
 }
+
+void DrawHud(const CControl *ctrl) {
+	DrawHud(ctrl, g_game.time, g_game.herring);
+}
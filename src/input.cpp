@@ -0,0 +1,59 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "input.h"
+
+CInput Input;
+
+CInput::CInput() : applied(-1.f) {}
+
+void CInput::Push(int action, float value) {
+	TInputEvent event;
+	event.time = Now();
+	event.action = action;
+	event.value = value;
+	std::lock_guard<std::mutex> lock(mutex);
+	queue.push_back(event);
+}
+
+bool CInput::Pop(float until, TInputEvent& event) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (queue.empty() || queue.front().time > until)
+		return false;
+	event = queue.front();
+	queue.pop_front();
+	if (applied < 0.f)
+		applied = event.time;
+	return true;
+}
+
+void CInput::Clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	queue.clear();
+	applied = -1.f;
+}
+
+float CInput::TakeApplied() {
+	std::lock_guard<std::mutex> lock(mutex);
+	float time = applied;
+	applied = -1.f;
+	return time;
+}
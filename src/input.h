@@ -0,0 +1,59 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+/* --------------------------------------------------------------------
+Timestamped input. The states push their input events with the time
+they were read, and the simulation takes them at the fixed step that
+covers this time, so a step sees the input that was held during it.
+The time of the first event taken since the last report gives the
+latency from the input to the frame that shows its result.
+--------------------------------------------------------------------- */
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "bh.h"
+#include <deque>
+#include <mutex>
+
+struct TInputEvent {
+	float time;		// s on the input clock
+	int action;		// defined by the state
+	float value;	// 1 or 0 for buttons, the position for axes
+};
+
+class CInput {
+private:
+	sf::Clock clock;
+	std::mutex mutex;
+	std::deque<TInputEvent> queue;
+	float applied;	// time of the first event taken, negative if none
+public:
+	CInput();
+
+	float Now() const { return clock.getElapsedTime().asSeconds(); }
+	void Push(int action, float value);
+	// the next event read before the given time
+	bool Pop(float until, TInputEvent& event);
+	void Clear();
+	// the time of the first event taken since the last call, negative if none
+	float TakeApplied();
+};
+
+extern CInput Input;
+
+#endif
@@ -34,6 +34,7 @@ GNU General Public License for more details.
 #include "winsys.h"
 #include "physics.h"
 #include "tux.h"
+#include "render_queue.h"
 
 CIntro Intro;
 static CKeyframe *startframe;
@@ -114,10 +115,12 @@ void CIntro::Loop(float time_step) {
 	RenderCourse();
 	DrawTrackmarks();
 	DrawTrees();
+	RenderQueue.Flush();
 
 	UpdateWind(time_step);
 	UpdateSnow(time_step, ctrl);
 	DrawSnow(ctrl);
+	RenderQueue.Flush();
 
 	g_game.character->shape->Draw();
 	DrawHud(ctrl);
@@ -0,0 +1,97 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "jobs.h"
+#include <algorithm>
+
+CJobSystem Jobs;
+
+CJobSystem::CJobSystem() : quit(false) {}
+
+CJobSystem::~CJobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	work_cond.notify_all();
+	for (std::size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+// The workers are started with the first job. One core is left for the
+// main thread, which takes part in the work while it waits.
+void CJobSystem::StartWorkers() {
+	unsigned int cores = std::thread::hardware_concurrency();
+	unsigned int num = cores > 1 ? cores - 1 : 1;
+	for (unsigned int i = 0; i < num; i++)
+		workers.emplace_back(&CJobSystem::Run, this);
+}
+
+// runs the first queued job, the lock is released meanwhile
+void CJobSystem::Execute(std::unique_lock<std::mutex>& lock) {
+	TJob job = queue.front();
+	queue.pop_front();
+	lock.unlock();
+	job.func();
+	lock.lock();
+	if (--job.group->pending == 0)
+		done_cond.notify_all();
+}
+
+void CJobSystem::Run() {
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		work_cond.wait(lock, [this] { return quit || !queue.empty(); });
+		if (quit) return;
+		Execute(lock);
+	}
+}
+
+void CJobSystem::Submit(CJobGroup& group, const std::function<void()>& func) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (workers.empty()) StartWorkers();
+		TJob job;
+		job.func = func;
+		job.group = &group;
+		queue.push_back(job);
+		group.pending++;
+	}
+	work_cond.notify_one();
+}
+
+void CJobSystem::ParallelFor(CJobGroup& group, std::size_t count, std::size_t chunk,
+                             const std::function<void(std::size_t, std::size_t)>& func) {
+	for (std::size_t first = 0; first < count; first += chunk) {
+		std::size_t last = std::min(first + chunk, count);
+		Submit(group, [func, first, last] { func(first, last); });
+	}
+}
+
+void CJobSystem::Wait(CJobGroup& group) {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (group.pending > 0) {
+		if (!queue.empty())
+			Execute(lock);
+		else
+			done_cond.wait(lock);
+	}
+}
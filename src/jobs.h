@@ -0,0 +1,72 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+/* --------------------------------------------------------------------
+A small job system. A fixed set of worker threads takes jobs from one
+queue. Jobs are counted in job groups, and waiting for a group lets the
+calling thread work on queued jobs too, so nothing stalls on machines
+with a single core.
+--------------------------------------------------------------------- */
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "bh.h"
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class CJobGroup {
+	friend class CJobSystem;
+	std::size_t pending;
+public:
+	CJobGroup() : pending(0) {}
+};
+
+class CJobSystem {
+private:
+	struct TJob {
+		std::function<void()> func;
+		CJobGroup* group;
+	};
+
+	std::vector<std::thread> workers;
+	std::deque<TJob> queue;
+	std::mutex mutex;
+	std::condition_variable work_cond;
+	std::condition_variable done_cond;
+	bool quit;
+
+	void StartWorkers();
+	void Run();
+	void Execute(std::unique_lock<std::mutex>& lock);
+public:
+	CJobSystem();
+	~CJobSystem();
+
+	void Submit(CJobGroup& group, const std::function<void()>& func);
+	// splits [0, count) into chunks and submits one job per chunk
+	void ParallelFor(CJobGroup& group, std::size_t count, std::size_t chunk,
+	                 const std::function<void(std::size_t, std::size_t)>& func);
+	void Wait(CJobGroup& group);
+};
+
+extern CJobSystem Jobs;
+
+#endif
@@ -27,7 +27,11 @@ GNU General Public License for more details.
 #include "font.h"
 #include "tools.h"
 #include "ogl_test.h"
+#include "benchmark.h"
+#include "replay.h"
+#include "telemetry.h"
 #include "winsys.h"
+#include "mathlib.h"
 #include <iostream>
 #include <ctime>
 #include <cstring>
@@ -41,9 +45,18 @@ void InitGame(int argc, char **argv) {
 		if (std::strcmp("--char", argv[1]) == 0)
 			g_game.argument = 4;
 		Tools.SetParameter(argv[2], argv[3]);
+	} else if (argc == 3) {
+		if (std::strcmp(argv[1], "--replay") == 0)
+			g_game.argument = 6;
+		else if (std::strcmp(argv[1], "--replay-headless") == 0)
+			g_game.argument = 7;
+		if (g_game.argument != 0 && !Replay.Load(argv[2]))
+			g_game.argument = -1;
 	} else if (argc == 2) {
 		if (std::strcmp(argv[1], "9") == 0)
 			g_game.argument = 9;
+		else if (std::strcmp(argv[1], "--benchmark") == 0)
+			g_game.argument = 5;
 	}
 
 	g_game.player = nullptr;
@@ -67,7 +80,13 @@ int main(int argc, char **argv) {
 
 	std::srand(std::time(nullptr));
 	InitConfig();
+	SeedRandomStreams(param.random_seed != 0 ? param.random_seed : std::time(nullptr));
 	InitGame(argc, argv);
+	if (g_game.argument == -1)
+		return -1;
+	if (g_game.argument == 7)
+		return Replay.RunHeadless();
+	Telemetry.Init();
 	Winsys.Init();
 	InitOpenglExtensions();
 
@@ -87,12 +106,16 @@ int main(int argc, char **argv) {
 
 	switch (g_game.argument) {
 		case 0:
+		case 6:
 			State::manager.Run(SplashScreen);
 			break;
 		case 4:
 			g_game.toolmode = TUXSHAPE;
 			State::manager.Run(Tools);
 			break;
+		case 5:
+			State::manager.Run(Benchmark);
+			break;
 		case 9:
 			State::manager.Run(OglTest);
 			break;
@@ -527,6 +527,63 @@ int IRandom(int min, int max) {
 	return min + std::rand()%(max-min+1);
 }
 
+// splitmix64, spreads a seed over the generator state
+static uint64_t SplitMix(uint64_t& x) {
+	uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+void CRandom::Seed(uint64_t seed) {
+	uint64_t a = SplitMix(seed);
+	uint64_t b = SplitMix(seed);
+	state[0] = (uint32_t)a;
+	state[1] = (uint32_t)(a >> 32);
+	state[2] = (uint32_t)b;
+	state[3] = (uint32_t)(b >> 32);
+}
+
+// Runs four interleaved copies of the generator, so the loop can be
+// vectorized. The copies are derived from this stream, which advances
+// by one step.
+void CRandom::Fill(float* values, std::size_t num, float min, float max) {
+	uint32_t s[4][4];
+	for (int j = 0; j < 4; j++) {
+		CRandom lane(((uint64_t)Next() << 32) | Next());
+		for (int k = 0; k < 4; k++) s[k][j] = lane.state[k];
+	}
+
+	const float scale = (max - min) * (1.f / 16777216.f);
+	std::size_t i = 0;
+	for (; i + 4 <= num; i += 4) {
+		for (int j = 0; j < 4; j++) {
+			uint32_t result = s[0][j] + s[3][j];
+			uint32_t t = s[1][j] << 9;
+			s[2][j] ^= s[0][j];
+			s[3][j] ^= s[1][j];
+			s[1][j] ^= s[2][j];
+			s[0][j] ^= s[3][j];
+			s[2][j] ^= t;
+			s[3][j] = Rotl(s[3][j], 11);
+			values[i + j] = min + (result >> 8) * scale;
+		}
+	}
+	for (; i < num; i++)
+		values[i] = Range(min, max);
+}
+
+static CRandom random_streams[NUM_RAND_STREAMS];
+
+void SeedRandomStreams(uint64_t seed) {
+	for (int i = 0; i < NUM_RAND_STREAMS; i++)
+		random_streams[i].Seed(seed + (uint64_t)i * 0x632BE59BD9B4E019ULL);
+}
+
+CRandom& RandomStream(TRandomStream stream) {
+	return random_streams[stream];
+}
+
 int ITrunc(int val, int base) {
 	return (int)(val / base);
 }
@@ -107,6 +107,45 @@ double LinearInterp(const double x[], const double y[], double val, int n);
 double	XRandom(double min, double max);
 double	FRandom();
 int		IRandom(int min, int max);
+
+// xoshiro128+ generator. Each subsystem owns a stream, so its results only
+// depend on the seed, and streams can be used on different threads.
+class CRandom {
+private:
+	uint32_t state[4];
+	static uint32_t Rotl(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+public:
+	explicit CRandom(uint64_t seed = 1) { Seed(seed); }
+	void Seed(uint64_t seed);
+	uint32_t Next() {
+		uint32_t result = state[0] + state[3];
+		uint32_t t = state[1] << 9;
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = Rotl(state[3], 11);
+		return result;
+	}
+	// [0, 1)
+	float Float() { return (Next() >> 8) * (1.f / 16777216.f); }
+	float Range(float min, float max) { return min + Float() * (max - min); }
+	int Int(int min, int max) { return min + (int)(Next() % (uint32_t)(max - min + 1)); }
+	void Fill(float* values, std::size_t num, float min, float max);
+};
+
+enum TRandomStream {
+	RAND_UI_SNOW,
+	RAND_PARTICLES,
+	RAND_FLAKES,
+	RAND_WEATHER,
+	RAND_TREES,
+	NUM_RAND_STREAMS
+};
+
+void SeedRandomStreams(uint64_t seed);
+CRandom& RandomStream(TRandomStream stream);
 int		ITrunc(int val, int base);
 int		IFrac(int val, int base);
 
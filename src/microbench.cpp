@@ -0,0 +1,215 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+// Micro benchmarks of the hot paths of terrain, collision, math and the
+// SP parsers, on the stock courses. The courses are loaded headless, so
+// no window or GL context is needed. Built with "make etr_microbench",
+// run from the same place as etr. Prints one line per function and course
+// with the time per call and the calls per second.
+
+#include "bh.h"
+#include "course.h"
+#include "env.h"
+#include "physics.h"
+#include "game_ctrl.h"
+#include "tux.h"
+#include "spx.h"
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#define BENCH_MIN_MS 200		// minimum run time of each function
+#define BENCH_POINTS 4096		// sample points per course, power of 2
+
+TGameData g_game;
+
+static volatile double bench_sink;	// keeps the results from being optimized away
+
+// Runs func(i) with growing counts of calls until the run takes at least
+// BENCH_MIN_MS, then prints the time per call.
+template<typename Func>
+static void Run(const char* name, const std::string& context, Func func) {
+	std::size_t calls = 64;
+	double ms = 0.0;
+	double sum = 0.0;
+	for (;;) {
+		sf::Clock clock;
+		for (std::size_t i = 0; i < calls; i++)
+			sum += func(i);
+		ms = clock.getElapsedTime().asMicroseconds() / 1000.0;
+		if (ms >= BENCH_MIN_MS) break;
+		calls *= 2;
+	}
+	bench_sink = sum;
+
+	double ns = ms * 1e6 / calls;
+	std::cout << std::left << std::setw(24) << name << std::setw(20) << context
+	          << std::right << std::fixed << std::setprecision(1)
+	          << std::setw(12) << ns << " ns/call"
+	          << std::setw(14) << 1e3 / ns << " Mcalls/s\n";
+}
+
+static void BenchMath() {
+	CRandom rand(1);
+	std::vector<TMatrix<4, 4> > matrices(64);
+	std::vector<TQuaternion> quats(64);
+	for (std::size_t i = 0; i < matrices.size(); i++) {
+		quats[i] = TQuaternion(rand.Range(-1, 1), rand.Range(-1, 1), rand.Range(-1, 1), rand.Range(-1, 1));
+		matrices[i] = MakeMatrixFromQuaternion(quats[i]);
+		matrices[i][3][0] = rand.Range(-10, 10);
+	}
+
+	Run("TMatrix multiply", "-", [&](std::size_t i) {
+		TMatrix<4, 4> m = matrices[i & 63] * matrices[(i + 1) & 63];
+		return m[1][2];
+	});
+	// the matrices have no general inverse, the transpose is the inverse
+	// of the rotations
+	Run("TMatrix transpose", "-", [&](std::size_t i) {
+		TMatrix<4, 4> m = matrices[i & 63].GetTransposed();
+		return m[1][2];
+	});
+	Run("MakeMatrixFromQuaternion", "-", [&](std::size_t i) {
+		TMatrix<4, 4> m = MakeMatrixFromQuaternion(quats[i & 63]);
+		return m[0][1];
+	});
+
+	// tree polyhedra near the unit sphere at the origin, as in the
+	// collision test of the character shape
+	std::vector<TPolyhedron> polys(64);
+	for (std::size_t i = 0; i < polys.size(); i++) {
+		TMatrix<4, 4> mat;
+		polys[i] = Course.GetPoly(1);
+		mat.SetScalingMatrix(rand.Range(0.5, 2), rand.Range(1, 4), rand.Range(0.5, 2));
+		TransPolyhedron(mat, polys[i]);
+		mat.SetTranslationMatrix(rand.Range(-2, 2), rand.Range(-2, 0), rand.Range(-2, 2));
+		TransPolyhedron(mat, polys[i]);
+	}
+	Run("IntersectPolyhedron", "-", [&](std::size_t i) {
+		return IntersectPolyhedron(polys[i & 63]) ? 1.0 : 0.0;
+	});
+	Run("TransPolyhedron", "-", [&](std::size_t i) {
+		TPolyhedron& ph = polys[i & 63];
+		TransPolyhedron(matrices[i & 63], ph);
+		TransPolyhedron(matrices[i & 63].GetTransposed(), ph);
+		return ph.vertices[0].x;
+	});
+}
+
+static void BenchParser() {
+	const std::string line =
+	    "*[name] Bunny Hill *[dir] bunny_hill *[x] 123 *[z] 456 *[height] 3.5 *[diam] 1.25";
+	Run("SPIntN", "-", [&](std::size_t i) {
+		return (double)SPIntN(line, (i & 1) ? "x" : "z", 0);
+	});
+	Run("SPFloatN", "-", [&](std::size_t i) {
+		return (double)SPFloatN(line, (i & 1) ? "height" : "diam", 0);
+	});
+}
+
+static void BenchCourse(CCourseList* group, TCourse* course, CControl* ctrl) {
+	Course.currentCourseList = group;
+	if (!Course.LoadCourse(course)) return;
+	std::string dir = param.common_course_dir + SEP + group->name + SEP + course->dir;
+
+	CRandom rand(2);
+	const TVector2d& size = Course.GetDimensions();
+	std::vector<TVector3d> points(BENCH_POINTS);
+	for (std::size_t i = 0; i < points.size(); i++) {
+		double x = rand.Range(0, size.x);
+		double z = -rand.Range(0, size.y);
+		points[i] = TVector3d(x, Course.FindYCoord(x, z), z);
+	}
+	// half of the collision tests near the trees, where the shape is checked
+	std::vector<TVector3d> coll_points(points);
+	for (std::size_t i = 0; i < coll_points.size() && !Course.CollArr.empty(); i += 2) {
+		const TVector3d& tree = Course.CollArr[rand.Int(0, (int)Course.CollArr.size() - 1)].pt;
+		double x = tree.x + rand.Range(-1, 1);
+		double z = tree.z + rand.Range(-1, 1);
+		coll_points[i] = TVector3d(x, Course.FindYCoord(x, z) + 0.3, z);
+	}
+
+	const std::string& name = course->dir;
+	Run("FindYCoord", name, [&](std::size_t i) {
+		const TVector3d& pt = points[i & (BENCH_POINTS - 1)];
+		return Course.FindYCoord(pt.x, pt.z);
+	});
+	Run("FindCourseNormal", name, [&](std::size_t i) {
+		const TVector3d& pt = points[i & (BENCH_POINTS - 1)];
+		return Course.FindCourseNormal(pt.x, pt.z).y;
+	});
+	Run("GetLocalCoursePlane", name, [&](std::size_t i) {
+		return Course.GetLocalCoursePlane(points[i & (BENCH_POINTS - 1)]).d;
+	});
+	if (g_game.character != nullptr) {
+		Run("CheckTreeCollisions", name, [&](std::size_t i) {
+			return ctrl->CheckTreeCollisions(coll_points[i & (BENCH_POINTS - 1)], nullptr) ? 1.0 : 0.0;
+		});
+	}
+	Run("CalcNormals", name, [&](std::size_t i) {
+		Course.CalcNormals();
+		return Course.Fields[i % Course.Fields.size()].nml.y;
+	});
+	Run("CSPList::Load", name, [&](std::size_t i) {
+		CSPList list;
+		list.Load(dir, "items.lst");
+		return (double)list.size();
+	});
+}
+
+int main() {
+	InitConfig();
+	g_game.player = nullptr;
+	g_game.character = nullptr;
+	g_game.force_treemap = false;
+	g_game.mirrorred = false;
+	g_game.treesize = 3;
+	g_game.treevar = 3;
+
+	Course.headless = true;
+	Course.MakeStandardPolyhedrons();
+	if (!Course.LoadObjectTypes() || !Course.LoadTerrainTypes() ||
+	        !Env.LoadEnvironmentList() || !Course.LoadCourseList()) {
+		Message("could not load the course data");
+		return -1;
+	}
+
+	// only the shape of tux is needed for the collision tests
+	TCharacter tux = TCharacter();
+	tux.shape = new CCharShape;
+	if (tux.shape->Load(param.char_dir + SEP "tux", "shape.lst", false))
+		g_game.character = &tux;
+	else
+		Message("could not load the shape of tux, no collision benchmark");
+	CControl ctrl;
+
+	BenchMath();
+	BenchParser();
+	for (std::size_t g = 0; g < Course.CourseLists.size(); g++) {
+		CCourseList* group = Course.getGroup(g);
+		for (std::size_t i = 0; i < group->size(); i++)
+			BenchCourse(group, &(*group)[i], &ctrl);
+	}
+
+	Course.ResetCourse();
+	delete tux.shape;
+	return 0;
+}
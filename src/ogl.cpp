@@ -55,6 +55,30 @@ void check_gl_error() {
 PFNGLLOCKARRAYSEXTPROC glLockArraysEXT_p = nullptr;
 PFNGLUNLOCKARRAYSEXTPROC glUnlockArraysEXT_p = nullptr;
 
+PFNGLGENBUFFERSPROC glGenBuffers_p = nullptr;
+PFNGLDELETEBUFFERSPROC glDeleteBuffers_p = nullptr;
+PFNGLBINDBUFFERPROC glBindBuffer_p = nullptr;
+PFNGLBUFFERDATAPROC glBufferData_p = nullptr;
+PFNGLBUFFERSUBDATAPROC glBufferSubData_p = nullptr;
+
+PFNGLACTIVETEXTUREARBPROC glActiveTexture_p = nullptr;
+PFNGLCLIENTACTIVETEXTUREARBPROC glClientActiveTexture_p = nullptr;
+
+PFNGLGENQUERIESPROC glGenQueries_p = nullptr;
+PFNGLDELETEQUERIESPROC glDeleteQueries_p = nullptr;
+PFNGLBEGINQUERYPROC glBeginQuery_p = nullptr;
+PFNGLENDQUERYPROC glEndQuery_p = nullptr;
+PFNGLGETQUERYOBJECTUI64VPROC glGetQueryObjectui64v_p = nullptr;
+
+std::size_t num_draw_calls = 0;
+
+static sf::GlFunctionPointer GetCoreOrArbFunction(const std::string& name) {
+	sf::GlFunctionPointer func = sf::Context::getFunction(name.c_str());
+	if (func == nullptr)
+		func = sf::Context::getFunction((name + "ARB").c_str());
+	return func;
+}
+
 void InitOpenglExtensions() {
 	glLockArraysEXT_p = (PFNGLLOCKARRAYSEXTPROC)sf::Context::getFunction("glLockArraysEXT");
 	glUnlockArraysEXT_p = (PFNGLUNLOCKARRAYSEXTPROC)sf::Context::getFunction("glUnlockArraysEXT");
@@ -64,6 +88,63 @@ void InitOpenglExtensions() {
 		glLockArraysEXT_p = nullptr;
 		glUnlockArraysEXT_p = nullptr;
 	}
+
+	glGenBuffers_p = (PFNGLGENBUFFERSPROC)GetCoreOrArbFunction("glGenBuffers");
+	glDeleteBuffers_p = (PFNGLDELETEBUFFERSPROC)GetCoreOrArbFunction("glDeleteBuffers");
+	glBindBuffer_p = (PFNGLBINDBUFFERPROC)GetCoreOrArbFunction("glBindBuffer");
+	glBufferData_p = (PFNGLBUFFERDATAPROC)GetCoreOrArbFunction("glBufferData");
+	glBufferSubData_p = (PFNGLBUFFERSUBDATAPROC)GetCoreOrArbFunction("glBufferSubData");
+
+	if (!HaveBufferObjects()) {
+		Message("GL_ARB_vertex_buffer_object extension NOT supported");
+		glGenBuffers_p = nullptr;
+		glDeleteBuffers_p = nullptr;
+		glBindBuffer_p = nullptr;
+		glBufferData_p = nullptr;
+		glBufferSubData_p = nullptr;
+	}
+
+	glActiveTexture_p = (PFNGLACTIVETEXTUREARBPROC)GetCoreOrArbFunction("glActiveTexture");
+	glClientActiveTexture_p = (PFNGLCLIENTACTIVETEXTUREARBPROC)GetCoreOrArbFunction("glClientActiveTexture");
+
+	if (!HaveMultitexture()) {
+		Message("GL_ARB_multitexture extension NOT supported");
+		glActiveTexture_p = nullptr;
+		glClientActiveTexture_p = nullptr;
+	}
+
+	// GL_TIME_ELAPSED queries need GL 3.3 or ARB_timer_query, which adds
+	// glGetQueryObjectui64v without suffix
+	glGenQueries_p = (PFNGLGENQUERIESPROC)GetCoreOrArbFunction("glGenQueries");
+	glDeleteQueries_p = (PFNGLDELETEQUERIESPROC)GetCoreOrArbFunction("glDeleteQueries");
+	glBeginQuery_p = (PFNGLBEGINQUERYPROC)GetCoreOrArbFunction("glBeginQuery");
+	glEndQuery_p = (PFNGLENDQUERYPROC)GetCoreOrArbFunction("glEndQuery");
+	glGetQueryObjectui64v_p = (PFNGLGETQUERYOBJECTUI64VPROC)sf::Context::getFunction("glGetQueryObjectui64v");
+
+	if (!HaveTimerQueries()) {
+		Message("GL_ARB_timer_query extension NOT supported");
+		glGenQueries_p = nullptr;
+		glDeleteQueries_p = nullptr;
+		glBeginQuery_p = nullptr;
+		glEndQuery_p = nullptr;
+		glGetQueryObjectui64v_p = nullptr;
+	}
+}
+
+bool HaveBufferObjects() {
+	return glGenBuffers_p != nullptr && glDeleteBuffers_p != nullptr &&
+	       glBindBuffer_p != nullptr && glBufferData_p != nullptr &&
+	       glBufferSubData_p != nullptr;
+}
+
+bool HaveMultitexture() {
+	return glActiveTexture_p != nullptr && glClientActiveTexture_p != nullptr;
+}
+
+bool HaveTimerQueries() {
+	return glGenQueries_p != nullptr && glDeleteQueries_p != nullptr &&
+	       glBeginQuery_p != nullptr && glEndQuery_p != nullptr &&
+	       glGetQueryObjectui64v_p != nullptr;
 }
 
 void PrintGLInfo() {
@@ -44,6 +44,31 @@ enum TRenderMode {
 extern PFNGLLOCKARRAYSEXTPROC glLockArraysEXT_p;
 extern PFNGLUNLOCKARRAYSEXTPROC glUnlockArraysEXT_p;
 
+// buffer objects (GL 1.5 or GL_ARB_vertex_buffer_object), nullptr if missing
+extern PFNGLGENBUFFERSPROC glGenBuffers_p;
+extern PFNGLDELETEBUFFERSPROC glDeleteBuffers_p;
+extern PFNGLBINDBUFFERPROC glBindBuffer_p;
+extern PFNGLBUFFERDATAPROC glBufferData_p;
+extern PFNGLBUFFERSUBDATAPROC glBufferSubData_p;
+bool HaveBufferObjects();
+
+// multitexture (GL 1.3 or GL_ARB_multitexture), nullptr if missing
+extern PFNGLACTIVETEXTUREARBPROC glActiveTexture_p;
+extern PFNGLCLIENTACTIVETEXTUREARBPROC glClientActiveTexture_p;
+bool HaveMultitexture();
+
+extern PFNGLGENQUERIESPROC glGenQueries_p;
+extern PFNGLDELETEQUERIESPROC glDeleteQueries_p;
+extern PFNGLBEGINQUERYPROC glBeginQuery_p;
+extern PFNGLENDQUERYPROC glEndQuery_p;
+extern PFNGLGETQUERYOBJECTUI64VPROC glGetQueryObjectui64v_p;
+bool HaveTimerQueries();
+
+// draw calls of the renderers: the glDrawArrays, glDrawElements and
+// glCallList calls, the glBegin/glEnd blocks and the SFML drawables,
+// reset by the caller and after each frame by the telemetry
+extern std::size_t num_draw_calls;
+
 void check_gl_error();
 void InitOpenglExtensions();
 void PrintGLInfo();
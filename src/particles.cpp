@@ -28,9 +28,20 @@ GNU General Public License for more details.
 #include "game_over.h"
 #include "winsys.h"
 #include "physics.h"
+#include "render_queue.h"
+#include "jobs.h"
+#include "effect_budget.h"
+#include "telemetry.h"
 #include <cstdlib>
-#include <list>
 #include <algorithm>
+#include <vector>
+#include <cfloat>
+#include <cstddef>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PARTICLES_SSE
+#endif
 
 // ====================================================================
 //					gui particles 2D
@@ -51,62 +62,43 @@ GNU General Public License for more details.
 #define PARTICLE_MIN_SIZE 1
 #define PARTICLE_SIZE_RANGE 10
 
+// The particles live in a fixed array that is recycled in place, they are
+// drawn as one vertex array. Positions are relative to the window size.
 struct TGuiParticle {
-	sf::Sprite sprite;
-	float size;
+	TVector2d pos;
 	TVector2d vel;
+	float size;
+	int type;
 
-	TGuiParticle(float x, float y);
-	void Draw() const;
+	void Reset(float x, float y);
 	void Update(float time_step, float push_timestep, const TVector2d& push_vector);
 };
 
-static std::list<TGuiParticle> particles_2d;
+static TGuiParticle particles_2d[MAX_num_snowparticles];
+static std::size_t num_particles_2d = 0;
+static sf::VertexArray ui_snow_vertices(sf::Quads);
 static TVector2d push_position(0, 0);
 static TVector2d last_push_position;
 static bool push_position_initialized = false;
 
-TGuiParticle::TGuiParticle(float x, float y) {
-	const sf::Texture& texture = Tex.GetSFTexture(SNOW_PART);
-	sprite.setTexture(texture);
-	sprite.setPosition(x*static_cast<float>(Winsys.resolution.width), y*static_cast<float>(Winsys.resolution.height));
-	sprite.setColor(sf::Color(255, 255, 255, 76));
-	double p_dist = FRandom();
+void TGuiParticle::Reset(float x, float y) {
+	CRandom& rnd = RandomStream(RAND_UI_SNOW);
+	pos = TVector2d(x, y);
+	double p_dist = rnd.Float();
 
 	size = PARTICLE_MIN_SIZE + (1.0 - p_dist) * PARTICLE_SIZE_RANGE;
 
-	sprite.setScale(size / (texture.getSize().x / 2), size / (texture.getSize().y / 2));
 	vel.x = 0;
 	vel.y = BASE_VELOCITY + p_dist * VELOCITY_RANGE;
 
-	int type = std::rand() % 4;
-	switch (type) {
-		case 0:
-			sprite.setTextureRect(sf::IntRect(0, 0, texture.getSize().x / 2, texture.getSize().y / 2));
-			break;
-		case 1:
-			sprite.setTextureRect(sf::IntRect(texture.getSize().x / 2, 0, texture.getSize().x / 2, texture.getSize().y / 2));
-			break;
-		case 2:
-			sprite.setTextureRect(sf::IntRect(texture.getSize().x / 2, texture.getSize().y / 2, texture.getSize().x / 2, texture.getSize().y / 2));
-			break;
-		case 3:
-			sprite.setTextureRect(sf::IntRect(0, texture.getSize().y / 2, texture.getSize().x / 2, texture.getSize().y / 2));
-			break;
-	}
-}
-
-void TGuiParticle::Draw() const {
-	Winsys.draw(sprite);
+	type = rnd.Int(0, 3);
 }
 
 void TGuiParticle::Update(float time_step, float push_timestep, const TVector2d& push_vector) {
 	TVector2d f;
 
-	float x = sprite.getPosition().x / static_cast<float>(Winsys.resolution.width);
-	float y = sprite.getPosition().y / static_cast<float>(Winsys.resolution.height);
-	float dist_from_push = (std::pow((x - push_position.x), 2) +
-	                        std::pow((y - push_position.y), 2));
+	float dist_from_push = (std::pow((pos.x - push_position.x), 2) +
+	                        std::pow((pos.y - push_position.y), 2));
 	if (push_timestep > 0) {
 		f = PUSH_FACTOR / push_timestep * push_vector;
 		f.x = clamp(-MAX_PUSH_FORCE, f.x, MAX_PUSH_FORCE);
@@ -118,21 +110,23 @@ void TGuiParticle::Update(float time_step, float push_timestep, const TVector2d&
 	vel.x += (f.x - vel.x * AIR_DRAG) *  time_step;
 	vel.y += (f.y + GRAVITY_FACTOR - vel.y * AIR_DRAG) * time_step;
 
-	x += vel.x * time_step * (size / PARTICLE_SIZE_RANGE);
-	y += vel.y * time_step * (size / PARTICLE_SIZE_RANGE);
+	pos.x += vel.x * time_step * (size / PARTICLE_SIZE_RANGE);
+	pos.y += vel.y * time_step * (size / PARTICLE_SIZE_RANGE);
 
-	x = clamp(-0.05f, x, 1.05f);
-	sprite.setPosition(x*Winsys.resolution.width, y*Winsys.resolution.height);
+	pos.x = clamp(-0.05, pos.x, 1.05);
 }
 
 void init_ui_snow() {
-	particles_2d.clear();
-	for (int i = 0; i < BASE_snowparticles * Winsys.resolution.width; i++)
-		particles_2d.emplace_back(static_cast<float>(FRandom()), static_cast<float>(FRandom()));
+	CRandom& rnd = RandomStream(RAND_UI_SNOW);
+	num_particles_2d = std::min<std::size_t>(BASE_snowparticles * Winsys.resolution.width, MAX_num_snowparticles);
+	for (std::size_t i = 0; i < num_particles_2d; i++)
+		particles_2d[i].Reset(rnd.Float(), rnd.Float());
+	ui_snow_vertices.resize(4 * MAX_num_snowparticles);
 	push_position = TVector2d(0.0, 0.0);
 }
 
 void update_ui_snow(float time_step) {
+	CRandom& rnd = RandomStream(RAND_UI_SNOW);
 	static sf::Clock timer;
 	float time = timer.getElapsedTime().asSeconds();
 	timer.restart();
@@ -146,29 +140,26 @@ void update_ui_snow(float time_step) {
 	}
 	last_push_position = push_position;
 
-	for (std::list<TGuiParticle>::iterator p = particles_2d.begin(); p != particles_2d.end(); ++p) {
-		p->Update(time_step, push_timestep, push_vector);
+	for (std::size_t i = 0; i < num_particles_2d; i++) {
+		particles_2d[i].Update(time_step, push_timestep, push_vector);
 	}
 
-	if (FRandom() < time_step*20.f*(MAX_num_snowparticles - particles_2d.size()) / 1000.f) {
-		particles_2d.emplace_back(static_cast<float>(FRandom()), -0.05f);
+	if (num_particles_2d < MAX_num_snowparticles &&
+	        rnd.Float() < time_step*20.f*(MAX_num_snowparticles - num_particles_2d) / 1000.f) {
+		particles_2d[num_particles_2d++].Reset(rnd.Float(), -0.05f);
 	}
 
-	for (std::list<TGuiParticle>::iterator p = particles_2d.begin(); p != particles_2d.end();) {
-		if (p->sprite.getPosition().y / static_cast<float>(Winsys.resolution.height) > 1.05) {
-			if (particles_2d.size() > BASE_snowparticles * Winsys.resolution.width && FRandom() > 0.2) {
-				p = particles_2d.erase(p);
+	for (std::size_t i = 0; i < num_particles_2d;) {
+		if (particles_2d[i].pos.y > 1.05) {
+			if (num_particles_2d > BASE_snowparticles * Winsys.resolution.width && rnd.Float() > 0.2) {
+				// the last particle takes the slot, it is checked next
+				particles_2d[i] = particles_2d[--num_particles_2d];
 			} else {
-				p->sprite.setPosition(static_cast<float>(Winsys.resolution.width)*FRandom(), static_cast<float>(Winsys.resolution.height) * (-FRandom()*BASE_VELOCITY));
-				double p_dist = FRandom();
-				p->size = PARTICLE_MIN_SIZE + (1.f - p_dist) * PARTICLE_SIZE_RANGE;
-				p->sprite.setScale(p->size / (p->sprite.getTexture()->getSize().x / 2), p->size / (p->sprite.getTexture()->getSize().x / 2));
-				p->vel.x = 0;
-				p->vel.y = BASE_VELOCITY + p_dist*VELOCITY_RANGE;
-				++p;
+				particles_2d[i].Reset(rnd.Float(), static_cast<float>(-rnd.Float()*BASE_VELOCITY));
+				++i;
 			}
 		} else
-			++p;
+			++i;
 	}
 
 	if (time_step < PUSH_DECAY_TIME_CONSTANT) {
@@ -179,9 +170,33 @@ void update_ui_snow(float time_step) {
 	}
 }
 void draw_ui_snow() {
-	for (std::list<TGuiParticle>::const_iterator i = particles_2d.begin(); i != particles_2d.end(); ++i) {
-		i->Draw();
+	const sf::Texture& texture = Tex.GetSFTexture(SNOW_PART);
+	const float tw = texture.getSize().x / 2;
+	const float th = texture.getSize().y / 2;
+	// top left corner of the four flake shapes in the texture
+	static const float tex_x[4] = { 0.f, 1.f, 1.f, 0.f };
+	static const float tex_y[4] = { 0.f, 0.f, 1.f, 1.f };
+	const sf::Color col(255, 255, 255, 76);
+	const float width = static_cast<float>(Winsys.resolution.width);
+	const float height = static_cast<float>(Winsys.resolution.height);
+
+	// shrinking keeps the storage reserved by init_ui_snow
+	ui_snow_vertices.resize(4 * num_particles_2d);
+	for (std::size_t i = 0; i < num_particles_2d; i++) {
+		const TGuiParticle& p = particles_2d[i];
+		float x = static_cast<float>(p.pos.x) * width;
+		float y = static_cast<float>(p.pos.y) * height;
+		float tx = tex_x[p.type] * tw;
+		float ty = tex_y[p.type] * th;
+
+		sf::Vertex* quad = &ui_snow_vertices[4 * i];
+		quad[0] = sf::Vertex(sf::Vector2f(x, y), col, sf::Vector2f(tx, ty));
+		quad[1] = sf::Vertex(sf::Vector2f(x + p.size, y), col, sf::Vector2f(tx + tw, ty));
+		quad[2] = sf::Vertex(sf::Vector2f(x + p.size, y + p.size), col, sf::Vector2f(tx + tw, ty + th));
+		quad[3] = sf::Vertex(sf::Vector2f(x, y + p.size), col, sf::Vector2f(tx, ty + th));
 	}
+
+	Winsys.draw(ui_snow_vertices, sf::RenderStates(&texture));
 }
 
 void push_ui_snow(const TVector2i& pos) {
@@ -212,27 +227,174 @@ void push_ui_snow(const TVector2i& pos) {
 #define MAX_PARTICLE_ANGLE_SPEED 50
 #define PARTICLE_SPEED_MULTIPLIER 0.3
 #define MAX_PARTICLE_SPEED 2.0
+#define PARTICLE_WIND_DRIFT 0.05f
+
+
+// The particles are kept in a pool with a fixed capacity, one float array
+// per attribute. Dead particles are removed by moving the last particle
+// into their slot, so the living ones always occupy [0, count). Apart from
+// the course height lookup the update runs as branch-free loops over the
+// arrays, which process four particles at once with SSE where available.
+struct TParticlePool {
+	float px[MAX_PARTICLES], py[MAX_PARTICLES], pz[MAX_PARTICLES];
+	float vx[MAX_PARTICLES], vy[MAX_PARTICLES], vz[MAX_PARTICLES];
+	float age[MAX_PARTICLES], death[MAX_PARTICLES];
+	float size[MAX_PARTICLES], alpha[MAX_PARTICLES];
+	float floor[MAX_PARTICLES];		// particles below this height are killed
+	float drift_x[MAX_PARTICLES], drift_z[MAX_PARTICLES];	// wind at the particle
+	unsigned char type[MAX_PARTICLES];
+	sf::Color tint[MAX_PARTICLES];	// from the terrain profile
+	unsigned char dead[MAX_PARTICLES];
+	std::size_t count;
+
+	std::size_t Add(std::size_t num);
+	void UpdateRange(std::size_t first, std::size_t last, float time_step);
+	void Compact();
+	void Clear() { count = 0; }
+};
+
+#define PARTICLE_JOB_SIZE 1024
+
+static TParticlePool particles;
+static CJobGroup particle_jobs;
+static bool particles_updating = false;
 
+// emission events of the physics sub-steps
+#define MAX_EMISSIONS 64
+
+static TParticleEmission emissions[MAX_EMISSIONS];
+static std::size_t num_emissions = 0;
+
+// reserves num particles at the end and returns the index of the first one,
+// num is reduced if the pool is full
+std::size_t TParticlePool::Add(std::size_t num) {
+	std::size_t first = count;
+	count = std::min(count + num, (std::size_t)MAX_PARTICLES);
+	return first;
+}
+
+// Updates the particles [first, last), the ranges can run as parallel jobs.
+// Dead particles are only marked, Compact must be called afterwards.
+void TParticlePool::UpdateRange(std::size_t first, std::size_t last, float time_step) {
+	const std::size_t n = last;
+	const float wind_drift = PARTICLE_WIND_DRIFT;
+	const float gravity = (float)EARTH_GRAV;
+	const float new_size = NEW_PART_SIZE;
+	const float grow = OLD_PART_SIZE - NEW_PART_SIZE;
+	std::size_t i;
+
+	// aging and integration; particles with negative age are not born
+	// yet and only move for the part of the step after their birth
+	Wind.SampleDrift(px + first, pz + first, n - first, drift_x + first, drift_z + first);
+	i = first;
+#ifdef PARTICLES_SSE
+	{
+		const __m128 step = _mm_set1_ps(time_step);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 drift = _mm_set1_ps(wind_drift);
+		const __m128 grav = _mm_set1_ps(gravity);
+		for (; i + 4 <= n; i += 4) {
+			__m128 a = _mm_add_ps(_mm_loadu_ps(age + i), step);
+			_mm_storeu_ps(age + i, a);
+			__m128 dt = _mm_min_ps(step, _mm_max_ps(zero, a));
+			__m128 vx4 = _mm_loadu_ps(vx + i);
+			__m128 vy4 = _mm_loadu_ps(vy + i);
+			__m128 vz4 = _mm_loadu_ps(vz + i);
+			_mm_storeu_ps(px + i, _mm_add_ps(_mm_loadu_ps(px + i), _mm_mul_ps(dt, vx4)));
+			_mm_storeu_ps(py + i, _mm_add_ps(_mm_loadu_ps(py + i), _mm_mul_ps(dt, vy4)));
+			_mm_storeu_ps(pz + i, _mm_add_ps(_mm_loadu_ps(pz + i), _mm_mul_ps(dt, vz4)));
+			__m128 dt_drift = _mm_mul_ps(dt, drift);
+			_mm_storeu_ps(vx + i, _mm_add_ps(vx4, _mm_mul_ps(dt_drift, _mm_loadu_ps(drift_x + i))));
+			_mm_storeu_ps(vy + i, _mm_sub_ps(vy4, _mm_mul_ps(dt, grav)));
+			_mm_storeu_ps(vz + i, _mm_add_ps(vz4, _mm_mul_ps(dt_drift, _mm_loadu_ps(drift_z + i))));
+		}
+	}
+#endif
+	for (; i < n; i++) {
+		age[i] += time_step;
+		float dt = std::min(time_step, std::max(0.f, age[i]));
+		px[i] += dt * vx[i];
+		py[i] += dt * vy[i];
+		pz[i] += dt * vz[i];
+		vx[i] += dt * wind_drift * drift_x[i];
+		vy[i] -= dt * gravity;
+		vz[i] += dt * wind_drift * drift_z[i];
+	}
+
+	// the height lookup stays scalar
+	for (i = first; i < n; i++) {
+		floor[i] = age[i] >= 0.f ? (float)Course.FindYCoord(px[i], pz[i]) - 3.f : -FLT_MAX;
+	}
+
+	// ground kill test, fading and growing; rel is only used for living
+	// particles
+	i = first;
+#ifdef PARTICLES_SSE
+	{
+		const __m128 one = _mm_set1_ps(1.f);
+		const __m128 size0 = _mm_set1_ps(new_size);
+		const __m128 grow4 = _mm_set1_ps(grow);
+		for (; i + 4 <= n; i += 4) {
+			__m128 a = _mm_loadu_ps(age + i);
+			__m128 d = _mm_loadu_ps(death + i);
+			__m128 kill = _mm_or_ps(_mm_cmplt_ps(_mm_loadu_ps(py + i), _mm_loadu_ps(floor + i)),
+			                        _mm_cmpge_ps(a, d));
+			int mask = _mm_movemask_ps(kill);
+			dead[i] = mask & 1;
+			dead[i+1] = (mask >> 1) & 1;
+			dead[i+2] = (mask >> 2) & 1;
+			dead[i+3] = (mask >> 3) & 1;
+			__m128 rel = _mm_div_ps(a, d);
+			_mm_storeu_ps(alpha + i, _mm_sub_ps(one, rel));
+			_mm_storeu_ps(size + i, _mm_add_ps(size0, _mm_mul_ps(grow4, rel)));
+		}
+	}
+#endif
+	for (; i < n; i++) {
+		dead[i] = (py[i] < floor[i]) | (age[i] >= death[i]);
+		float rel = age[i] / death[i];
+		alpha[i] = 1.f - rel;
+		size[i] = new_size + grow * rel;
+	}
+}
+
+void TParticlePool::Compact() {
+	std::size_t i = 0;
+	while (i < count) {
+		if (!dead[i]) {
+			i++;
+			continue;
+		}
+		std::size_t last = --count;
+		px[i] = px[last];
+		py[i] = py[last];
+		pz[i] = pz[last];
+		vx[i] = vx[last];
+		vy[i] = vy[last];
+		vz[i] = vz[last];
+		age[i] = age[last];
+		death[i] = death[last];
+		size[i] = size[last];
+		alpha[i] = alpha[last];
+		type[i] = type[last];
+		tint[i] = tint[last];
+		dead[i] = dead[last];
+	}
+}
 
-struct Particle {
-	TVector3d pt;
-	short type;
-	double base_size;
-	double cur_size;
-	double terrain_height;
-	double age;
-	double death;
-	double alpha;
-	TVector3d vel;
-
-	void Draw(const CControl* ctrl) const;
-private:
-	void draw_billboard(const CControl *ctrl, double width, double height, bool use_world_y_axis, const GLfloat* tex) const;
+// All visible particles are built into one vertex array per frame, which
+// is streamed into a buffer object and drawn with a single call.
+struct TParticleVertex {
+	GLfloat x, y, z;
+	GLfloat u, v;
+	GLubyte col[4];
 };
 
-static std::list<Particle> particles;
+static std::vector<TParticleVertex> particle_vertices;
+static GLuint particle_buffer = 0;
+static std::size_t particle_buffer_size = 0;
 
-void Particle::Draw(const CControl* ctrl) const {
+static std::size_t build_particle_quads(const CControl *ctrl) {
 	static const GLfloat tex_coords[4][8] = {
 		{
 			0.0, 0.5,
@@ -257,141 +419,162 @@ void Particle::Draw(const CControl* ctrl) const {
 		}
 	};
 
+	// camera-facing axes
+	const float xx = ctrl->view_mat[0][0], xy = ctrl->view_mat[0][1], xz = ctrl->view_mat[0][2];
+	const float yx = ctrl->view_mat[1][0], yy = ctrl->view_mat[1][1], yz = ctrl->view_mat[1][2];
 	const sf::Color& particle_colour = Env.ParticleColor();
-	glColor(particle_colour, particle_colour.a * alpha);
-
-	draw_billboard(ctrl, cur_size, cur_size, false, tex_coords[type]);
-}
-
-void Particle::draw_billboard(const CControl *ctrl, double width, double height, bool use_world_y_axis, const GLfloat* tex) const {
-	TVector3d x_vec;
-	TVector3d y_vec;
-	TVector3d z_vec;
 
-	x_vec.x = ctrl->view_mat[0][0];
-	x_vec.y = ctrl->view_mat[0][1];
-	x_vec.z = ctrl->view_mat[0][2];
-
-	if (use_world_y_axis) {
-		y_vec = TVector3d(0, 1, 0);
-		x_vec = ProjectToPlane(y_vec, x_vec);
-		x_vec.Norm();
-		z_vec = CrossProduct(x_vec, y_vec);
-	} else {
-		y_vec.x = ctrl->view_mat[1][0];
-		y_vec.y = ctrl->view_mat[1][1];
-		y_vec.z = ctrl->view_mat[1][2];
-		z_vec.x = ctrl->view_mat[2][0];
-		z_vec.y = ctrl->view_mat[2][1];
-		z_vec.z = ctrl->view_mat[2][2];
+	particle_vertices.resize(4 * particles.count);
+	TParticleVertex* vtx = particle_vertices.data();
+	std::size_t num = 0;
+	for (std::size_t i = 0; i < particles.count; i++) {
+		if (particles.age[i] < 0.f) continue;
+
+		float half = particles.size[i] / 2.f;
+		float ax = half * (xx + yx), ay = half * (xy + yy), az = half * (xz + yz);
+		float bx = half * (xx - yx), by = half * (xy - yy), bz = half * (xz - yz);
+		const float corners[4][3] = {
+			{ -ax, -ay, -az },	// -x -y
+			{  bx,  by,  bz },	// +x -y
+			{  ax,  ay,  az },	// +x +y
+			{ -bx, -by, -bz }	// -x +y
+		};
+		const GLfloat* tex = tex_coords[particles.type[i]];
+		GLubyte alpha = (GLubyte)(particle_colour.a * particles.alpha[i]);
+		const sf::Color& tint = particles.tint[i];
+		GLubyte r = (GLubyte)(particle_colour.r * tint.r / 255);
+		GLubyte g = (GLubyte)(particle_colour.g * tint.g / 255);
+		GLubyte b = (GLubyte)(particle_colour.b * tint.b / 255);
+
+		for (int c = 0; c < 4; c++) {
+			vtx->x = particles.px[i] + corners[c][0];
+			vtx->y = particles.py[i] + corners[c][1];
+			vtx->z = particles.pz[i] + corners[c][2];
+			vtx->u = tex[2*c];
+			vtx->v = tex[2*c+1];
+			vtx->col[0] = r;
+			vtx->col[1] = g;
+			vtx->col[2] = b;
+			vtx->col[3] = alpha;
+			vtx++;
+		}
+		num += 4;
 	}
+	return num;
+}
 
-	TVector3d pt1 = pt - width/2.0 * x_vec - height/2.0 * y_vec;
-	TVector3d pt2 = pt1 + width * x_vec;
-	TVector3d pt3 = pt2 + height * y_vec;
-	TVector3d pt4 = pt3 + -width * x_vec;
-	const GLfloat vtx[] = {
-		static_cast<GLfloat>(pt1.x),
-		static_cast<GLfloat>(pt1.y),
-		static_cast<GLfloat>(pt1.z),
-		static_cast<GLfloat>(pt2.x),
-		static_cast<GLfloat>(pt2.y),
-		static_cast<GLfloat>(pt2.z),
-		static_cast<GLfloat>(pt3.x),
-		static_cast<GLfloat>(pt3.y),
-		static_cast<GLfloat>(pt3.z),
-		static_cast<GLfloat>(pt4.x),
-		static_cast<GLfloat>(pt4.y),
-		static_cast<GLfloat>(pt4.z),
-	};
-
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-
-	glVertexPointer(3, GL_FLOAT, 0, vtx);
-	glTexCoordPointer(2, GL_FLOAT, 0, tex);
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-	glDisableClientState(GL_VERTEX_ARRAY);
+// waits for the jobs started by update_particles
+static void finish_particle_update() {
+	if (!particles_updating) return;
+	Jobs.Wait(particle_jobs);
+	particles.Compact();
+	particles_updating = false;
 }
 
-void create_new_particles(const TVector3d& loc, const TVector3d& vel, std::size_t num) {
+void create_new_particles(const TVector3d& loc, const TVector3d& vel, std::size_t num, const sf::Color& tint) {
+	CRandom& rnd = RandomStream(RAND_PARTICLES);
+	finish_particle_update();
 	double speed = vel.Length();
 
-	if (particles.size() + num > MAX_PARTICLES) {
+	std::size_t first = particles.Add(num);
+	if (particles.count - first < num) {
 		Message("maximum number of particles exceeded");
 	}
-	for (std::size_t i=0; i<num; i++) {
-		particles.emplace_back();
-		Particle* newp = &particles.back();
-		newp->pt.x = loc.x + 2.*(FRandom() - 0.5) * START_RADIUS;
-		newp->pt.y = loc.y;
-		newp->pt.z = loc.z + 2.*(FRandom() - 0.5) * START_RADIUS;
-		newp->type = std::rand() % 4;
-		newp->base_size = (FRandom() + 0.5) * OLD_PART_SIZE;
-		newp->cur_size = NEW_PART_SIZE;
-		newp->age = FRandom() * MIN_AGE;
-		newp->death = FRandom() * MAX_AGE;
-		newp->vel = vel +
-		            TVector3d(VARIANCE_FACTOR * (FRandom() - 0.5) * speed,
-		                      VARIANCE_FACTOR * (FRandom() - 0.5) * speed,
-		                      VARIANCE_FACTOR * (FRandom() - 0.5) * speed);
+	for (std::size_t i = first; i < particles.count; i++) {
+		particles.px[i] = loc.x + 2.*(rnd.Float() - 0.5) * START_RADIUS;
+		particles.py[i] = loc.y;
+		particles.pz[i] = loc.z + 2.*(rnd.Float() - 0.5) * START_RADIUS;
+		particles.type[i] = rnd.Int(0, 3);
+		particles.tint[i] = tint;
+		particles.size[i] = NEW_PART_SIZE;
+		particles.alpha[i] = 1.f;
+		particles.age[i] = rnd.Float() * MIN_AGE;
+		particles.death[i] = rnd.Float() * MAX_AGE;
+		particles.vx[i] = vel.x + VARIANCE_FACTOR * (rnd.Float() - 0.5) * speed;
+		particles.vy[i] = vel.y + VARIANCE_FACTOR * (rnd.Float() - 0.5) * speed;
+		particles.vz[i] = vel.z + VARIANCE_FACTOR * (rnd.Float() - 0.5) * speed;
 	}
 }
+// The update runs as parallel jobs, it is finished by the next call that
+// accesses the particles, usually draw_particles.
 void update_particles(float time_step) {
-	for (std::list<Particle>::iterator p = particles.begin(); p != particles.end();) {
-		p->age += time_step;
-		if (p->age < 0) {
-			++p;
-			continue;
-		}
-
-		p->pt += static_cast<double>(time_step) * p->vel;
-		double ycoord = Course.FindYCoord(p->pt.x, p->pt.z);
-		if (p->pt.y < ycoord - 3)
-			p->age = p->death + 1;
-		if (p->age >= p->death) {
-			p = particles.erase(p);
-			continue;
-		}
-		p->alpha = (p->death - p->age) / p->death;
-		p->cur_size = NEW_PART_SIZE +
-		              (OLD_PART_SIZE - NEW_PART_SIZE) * (p->age / p->death);
-		p->vel.y += -EARTH_GRAV * time_step;
-		++p;
-	}
+	CEffectBudget::Timer timer(EFFECT_PARTICLES);
+	finish_particle_update();
+	Telemetry.Set(CNT_PARTICLES, particles.count);
+	Jobs.ParallelFor(particle_jobs, particles.count, PARTICLE_JOB_SIZE, [time_step](std::size_t first, std::size_t last) {
+		particles.UpdateRange(first, last, time_step);
+	});
+	particles_updating = true;
 }
 void draw_particles(const CControl *ctrl) {
-	if (particles.empty())
+	CEffectBudget::Timer timer(EFFECT_PARTICLES);
+	finish_particle_update();
+	if (particles.count == 0)
+		return;
+
+	std::size_t num = build_particle_quads(ctrl);
+	if (num == 0)
 		return;
 
 	ScopedRenderMode rm(PARTICLES);
 	Tex.BindTex(SNOW_PART);
 	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-	glColor4f(1.f, 1.f, 1.f, 0.8f);
 
-	for (std::list<Particle>::const_iterator p = particles.begin(); p != particles.end(); ++p) {
-		if (p->age >= 0)
-			p->Draw(ctrl);
+	const GLubyte* base = (const GLubyte*)particle_vertices.data();
+	if (HaveBufferObjects()) {
+		std::size_t size = num * sizeof(TParticleVertex);
+		if (particle_buffer == 0) glGenBuffers_p(1, &particle_buffer);
+		glBindBuffer_p(GL_ARRAY_BUFFER, particle_buffer);
+		particle_buffer_size = std::max(particle_buffer_size, size);
+		// orphan the storage of the last frame, so no sync is needed
+		glBufferData_p(GL_ARRAY_BUFFER, particle_buffer_size, nullptr, GL_STREAM_DRAW);
+		glBufferSubData_p(GL_ARRAY_BUFFER, 0, size, base);
+		base = nullptr;
 	}
+
+	const GLsizei stride = sizeof(TParticleVertex);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, stride, base + offsetof(TParticleVertex, x));
+	glTexCoordPointer(2, GL_FLOAT, stride, base + offsetof(TParticleVertex, u));
+	glColorPointer(4, GL_UNSIGNED_BYTE, stride, base + offsetof(TParticleVertex, col));
+	glDrawArrays(GL_QUADS, 0, (GLsizei)num);
+	num_draw_calls++;
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+
+	if (particle_buffer != 0)
+		glBindBuffer_p(GL_ARRAY_BUFFER, 0);
 }
 void clear_particles() {
-	particles.clear();
+	finish_particle_update();
+	particles.Clear();
+	num_emissions = 0;
+	Telemetry.Set(CNT_PARTICLES, 0);
 }
 
 static double adjust_particle_count(double count) {
 	if (count < 1) {
-		if (((double)std::rand()) / RAND_MAX < count) return 1.0;
+		if (RandomStream(RAND_PARTICLES).Float() < count) return 1.0;
 		else return 0.0;
 	} else return count;
 }
 
-void generate_particles(const CControl *ctrl, double dtime, const TVector3d& pos, double speed) {
+// The emission rates are scaled by the effect budget.
+static void generate_particles(const CControl *ctrl, double dtime, const TVector3d& pos, double speed) {
+	if (!EffectBudget.Enabled(EFFECT_PARTICLES))
+		return;
+	CEffectBudget::Timer timer(EFFECT_PARTICLES);
+	dtime *= EffectBudget.Scale(EFFECT_PARTICLES);
+
 	double surf_y = Course.FindYCoord(pos.x, pos.z);
 
 	int id = Course.GetTerrainIdx(pos.x, pos.z, 0.5);
 	if (id >= 0 && Course.TerrList[id].particles && pos.y < surf_y) {
+		const TTerrType& terr = Course.TerrList[id];
+		dtime *= terr.part_rate;
 		TVector3d xvec = CrossProduct(ctrl->cdirection, ctrl->plane_nml);
 
 		TVector3d right_part_pt = pos + TUX_WIDTH/2.0 * xvec;
@@ -436,9 +619,44 @@ void generate_particles(const CControl *ctrl, double dtime, const TVector3d& pos
 		right_part_vel *= std::min(MAX_PARTICLE_SPEED, speed * PARTICLE_SPEED_MULTIPLIER);
 
 
-		create_new_particles(left_part_pt, left_part_vel, (std::size_t)left_particles);
-		create_new_particles(right_part_pt, right_part_vel, (std::size_t)right_particles);
+		create_new_particles(left_part_pt, left_part_vel, (std::size_t)left_particles, terr.part_col);
+		create_new_particles(right_part_pt, right_part_vel, (std::size_t)right_particles, terr.part_col);
+	}
+}
+
+// The physics only records the position and speed of each sub-step, the
+// emission with its terrain lookups runs once per frame afterwards. If
+// the buffer is full the last event is extended, so no time is lost.
+void queue_particle_emission(double dtime, const TVector3d& pos, double speed) {
+	if (num_emissions == MAX_EMISSIONS) {
+		TParticleEmission& last = emissions[MAX_EMISSIONS - 1];
+		last.dtime += dtime;
+		last.pos = pos;
+		last.speed = speed;
+		return;
 	}
+	emissions[num_emissions].pos = pos;
+	emissions[num_emissions].dtime = dtime;
+	emissions[num_emissions].speed = speed;
+	num_emissions++;
+}
+
+void emit_queued_particles(const CControl *ctrl) {
+	for (std::size_t i = 0; i < num_emissions; i++)
+		generate_particles(ctrl, emissions[i].dtime, emissions[i].pos, emissions[i].speed);
+	num_emissions = 0;
+}
+
+// With the physics on the simulation thread the queue belongs to that
+// thread, the events are handed over to the renderer with the snapshots.
+void take_queued_emissions(std::vector<TParticleEmission>& out) {
+	out.insert(out.end(), emissions, emissions + num_emissions);
+	num_emissions = 0;
+}
+
+void emit_particles(const CControl *ctrl, const std::vector<TParticleEmission>& events) {
+	for (std::size_t i = 0; i < events.size(); i++)
+		generate_particles(ctrl, events[i].dtime, events[i].pos, events[i].speed);
 }
 
 // --------------------------------------------------------------------
@@ -447,32 +665,14 @@ void generate_particles(const CControl *ctrl, double dtime, const TVector3d& pos
 
 #define SNOW_WIND_DRIFT  0.1
 
-static CFlakes Flakes;
-
-
-void TFlake::Draw(const TPlane& lp, const TPlane& rp, bool rotate_flake, float dir_angle) const {
-	if ((DistanceToPlane(lp, pt) < 0) && (DistanceToPlane(rp, pt) < 0)) {
-		glPushMatrix();
-		glTranslate(pt);
-		if (rotate_flake) glRotatef(dir_angle, 0, 1, 0);
-
-		const GLfloat vtx[] = {
-			0,    0,    0,
-			size, 0,    0,
-			size, size, 0,
-			0,    size, 0
-		};
-		glVertexPointer(3, GL_FLOAT, 0, vtx);
-		glTexCoordPointer(2, GL_FLOAT, 0, tex);
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+#define FLAKE_JOB_SIZE 512
 
-		glPopMatrix();
-	}
-}
+static CFlakes Flakes;
+static CJobGroup snow_jobs;	// flakes and curtains
 
 
 TFlakeArea::TFlakeArea(
-    std::size_t num_flakes,
+    std::size_t num_flakes_,
     float xrange_,
     float ytop_,
     float yrange_,
@@ -482,7 +682,10 @@ TFlakeArea::TFlakeArea(
     float maxSize_,
     float speed_,
     bool  rotate)
-	: flakes(num_flakes) {
+	: num_flakes(num_flakes_), num_visible(num_flakes_),
+	  base_x(num_flakes_), base_y(num_flakes_), base_z(num_flakes_),
+	  fall(num_flakes_), size(num_flakes_),
+	  texcoords(8 * num_flakes_), vertices(12 * num_flakes_) {
 	xrange = xrange_;
 	ytop = ytop_;
 	yrange = yrange_;
@@ -493,68 +696,119 @@ TFlakeArea::TFlakeArea(
 	speed = speed_;
 	rotate_flake = rotate;
 	left = right = bottom = top = front = back = 0.f;
+	xorigin = yorigin = zorigin = time = 0.0;
+	xshift = yshift = zshift = 0.f;
+	xaxis_x = 1.f;
+	xaxis_z = 0.f;
+	tex_buffer = vertex_buffer = 0;
 }
 
-void TFlakeArea::Draw(const CControl *ctrl) const {
-	if (g_game.snow_id < 1 || flakes.empty())
-		return;
-
-	const TPlane& lp = get_left_clip_plane();
-	const TPlane& rp = get_right_clip_plane();
-	float dir_angle(std::atan(ctrl->viewdir.x / ctrl->viewdir.z) * 180 / M_PI);
+static float WrapOffset(double offset, float range) {
+	double wrapped = std::fmod(offset, (double)range);
+	if (wrapped < 0.0) wrapped += range;
+	return (float)wrapped;
+}
 
-	ScopedRenderMode rm(PARTICLES);
-	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-	Tex.BindTex(SNOW_PART);
-	const sf::Color& particle_colour = Env.ParticleColor();
-	glColor(particle_colour);
+// Called once per frame on the main thread, after the box has been moved.
+void TFlakeArea::SetOffsets(const CControl *ctrl) {
+	xshift = WrapOffset(xorigin - left, xrange);
+	yshift = WrapOffset(yorigin - bottom, yrange);
+	zshift = WrapOffset(zorigin - front, zrange);
+
+	xaxis_x = 1.f;
+	xaxis_z = 0.f;
+	if (rotate_flake) {
+		double dir_angle = std::atan(ctrl->viewdir.x / ctrl->viewdir.z);
+		xaxis_x = std::cos(dir_angle);
+		xaxis_z = -std::sin(dir_angle);
+	}
+}
 
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-	for (std::size_t i=0; i < flakes.size(); i++) {
-		flakes[i].Draw(lp, rp, rotate_flake, dir_angle);
+// Computes the quads of the flakes [first, last). Only reads the state of
+// the area, so the ranges can be built in parallel.
+void TFlakeArea::Build(std::size_t first, std::size_t last) {
+	const float* bx = base_x.data();
+	const float* by = base_y.data();
+	const float* bz = base_z.data();
+	const float* fs = fall.data();
+	const float* sz = size.data();
+	GLfloat* vtx = vertices.data();
+
+	for (std::size_t i = first; i < last; i++) {
+		// base and shift are both inside [0, range), one subtraction wraps
+		float x = bx[i] + xshift;
+		x -= xrange * (float)(x >= xrange);
+		float z = bz[i] + zshift;
+		z -= zrange * (float)(z >= zrange);
+		double y = by[i] + fs[i] * time + yshift;
+		y -= yrange * std::floor(y / yrange);
+
+		float px = left + x;
+		float py = bottom + (float)y;
+		float pz = front + z;
+		float s = sz[i];
+		float rx = px + s * xaxis_x;
+		float rz = pz + s * xaxis_z;
+
+		GLfloat* v = vtx + 12 * i;
+		v[0] = px; v[1] = py; v[2] = pz;
+		v[3] = rx; v[4] = py; v[5] = rz;
+		v[6] = rx; v[7] = py + s; v[8] = rz;
+		v[9] = px; v[10] = py + s; v[11] = pz;
 	}
-	glDisableClientState(GL_VERTEX_ARRAY);
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 }
 
-void TFlakeArea::Update(float timestep, float xcoeff, float ycoeff, float zcoeff) {
-	for (std::size_t i=0; i<flakes.size(); i++) {
-		flakes[i].pt.x += xcoeff;
-		flakes[i].pt.y += flakes[i].vel.y * timestep + ycoeff;
-		flakes[i].pt.z += zcoeff;
-
-		if (flakes[i].pt.y < bottom) {
-			flakes[i].pt.y += yrange;
-		} else if (flakes[i].pt.x < left) {
-			flakes[i].pt.x += xrange;
-		} else if (flakes[i].pt.x > right) {
-			flakes[i].pt.x -= xrange;
-		} else if (flakes[i].pt.y > top) {
-			flakes[i].pt.y -= yrange;
-		} else if (flakes[i].pt.z < front) {
-			flakes[i].pt.z += zrange;
-		} else if (flakes[i].pt.z > back) {
-			flakes[i].pt.z -= zrange;
+// Draws all flakes of the area with one call, the render state is set up
+// by CFlakes::Draw.
+void TFlakeArea::Draw() {
+	if (num_visible == 0)
+		return;
+
+	const GLubyte* tex_base = (const GLubyte*)texcoords.data();
+	const GLubyte* vertex_base = (const GLubyte*)vertices.data();
+	if (HaveBufferObjects()) {
+		if (tex_buffer == 0) {
+			glGenBuffers_p(1, &tex_buffer);
+			glBindBuffer_p(GL_ARRAY_BUFFER, tex_buffer);
+			glBufferData_p(GL_ARRAY_BUFFER, texcoords.size() * sizeof(GLfloat), texcoords.data(), GL_STATIC_DRAW);
 		}
+		if (vertex_buffer == 0) glGenBuffers_p(1, &vertex_buffer);
+		glBindBuffer_p(GL_ARRAY_BUFFER, vertex_buffer);
+		// only the visible flakes, 4 corners of 3 floats each
+		glBufferData_p(GL_ARRAY_BUFFER, 12 * num_visible * sizeof(GLfloat), vertices.data(), GL_STREAM_DRAW);
+		tex_base = nullptr;
+		vertex_base = nullptr;
 	}
+
+	if (tex_buffer != 0) glBindBuffer_p(GL_ARRAY_BUFFER, tex_buffer);
+	glTexCoordPointer(2, GL_FLOAT, 0, tex_base);
+	if (vertex_buffer != 0) glBindBuffer_p(GL_ARRAY_BUFFER, vertex_buffer);
+	glVertexPointer(3, GL_FLOAT, 0, vertex_base);
+	glDrawArrays(GL_QUADS, 0, (GLsizei)(4 * num_visible));
+	num_draw_calls++;
+}
+
+void TFlakeArea::ReleaseBuffers() {
+	if (tex_buffer != 0) glDeleteBuffers_p(1, &tex_buffer);
+	if (vertex_buffer != 0) glDeleteBuffers_p(1, &vertex_buffer);
+	tex_buffer = vertex_buffer = 0;
 }
 
 void CFlakes::Reset() {
+	for (std::size_t ar=0; ar<areas.size(); ar++)
+		areas[ar].ReleaseBuffers();
 	areas.clear();
 }
 
 void CFlakes::MakeSnowFlake(std::size_t ar, std::size_t i) {
-	areas[ar].flakes[i].pt.x = XRandom(areas[ar].left, areas[ar].right);
-	areas[ar].flakes[i].pt.y = -XRandom(areas[ar].top, areas[ar].bottom);
-	areas[ar].flakes[i].pt.z = areas[ar].back - FRandom() * (areas[ar].back - areas[ar].front);
+	TFlakeArea& area = areas[ar];
+	// the float rounding of the bulk values may reach the upper bound
+	if (area.base_x[i] >= area.xrange) area.base_x[i] = 0.f;
+	if (area.base_z[i] >= area.zrange) area.base_z[i] = 0.f;
 
-	areas[ar].flakes[i].size = XRandom(areas[ar].minSize, areas[ar].maxSize);
-	areas[ar].flakes[i].vel.x = 0;
-	areas[ar].flakes[i].vel.z = 0;
-	areas[ar].flakes[i].vel.y = -areas[ar].flakes[i].size * areas[ar].speed;
+	area.fall[i] = -area.size[i] * area.speed;
 
-	int type = std::rand() % 4;
+	int type = RandomStream(RAND_FLAKES).Int(0, 3);
 
 	static const GLfloat tex_coords[4][8] = {
 		{
@@ -580,14 +834,27 @@ void CFlakes::MakeSnowFlake(std::size_t ar, std::size_t i) {
 		}
 	};
 
-	areas[ar].flakes[i].tex = tex_coords[type];
+	std::copy(tex_coords[type], tex_coords[type] + 8, &area.texcoords[8 * i]);
 }
 
 void CFlakes::GenerateSnowFlakes(const CControl *ctrl) {
 	if (g_game.snow_id < 1) return;
 	snow_lastpos = ctrl->cpos;
 	for (std::size_t ar=0; ar<areas.size(); ar++) {
-		for (std::size_t i=0; i<areas[ar].flakes.size(); i++) MakeSnowFlake(ar, i);
+		TFlakeArea& area = areas[ar];
+		CRandom& rnd = RandomStream(RAND_FLAKES);
+		rnd.Fill(area.base_x.data(), area.num_flakes, 0.f, area.xrange);
+		rnd.Fill(area.base_y.data(), area.num_flakes, 0.f, area.yrange);
+		rnd.Fill(area.base_z.data(), area.num_flakes, 0.f, area.zrange);
+		rnd.Fill(area.size.data(), area.num_flakes, area.minSize, area.maxSize);
+		for (std::size_t i=0; i<area.num_flakes; i++) MakeSnowFlake(ar, i);
+		area.xorigin = area.left;
+		area.yorigin = area.bottom;
+		area.zorigin = area.front;
+		area.time = 0.0;
+		area.SetOffsets(ctrl);
+		area.num_visible = (std::size_t)(area.num_flakes * EffectBudget.Scale(EFFECT_FLAKES));
+		area.Build(0, area.num_visible);
 	}
 }
 
@@ -651,6 +918,7 @@ void CFlakes::Init(int grade, const CControl *ctrl) {
 }
 
 void CFlakes::Update(float timestep, const CControl *ctrl) {
+	CEffectBudget::Timer timer(EFFECT_FLAKES);
 	if (g_game.snow_id < 1)
 		return;
 
@@ -662,20 +930,45 @@ void CFlakes::Update(float timestep, const CControl *ctrl) {
 		ydiff = ctrl->cpos.y - snow_lastpos.y;
 	}
 
-	TVector3d winddrift = SNOW_WIND_DRIFT * Wind.WindDrift();
+	TVector3d winddrift = SNOW_WIND_DRIFT * Wind.DriftAt(ctrl->cpos);
 	float xcoeff = winddrift.x * timestep;
 	float ycoeff = (ydiff * YDRIFT) + (winddrift.z * timestep);
 	float zcoeff = (zdiff * ZDRIFT) + (winddrift.z * timestep);
 
 	for (std::size_t ar=0; ar<areas.size(); ar++) {
-		areas[ar].Update(timestep, xcoeff, ycoeff, zcoeff);
+		TFlakeArea* area = &areas[ar];
+		area->xorigin += xcoeff;
+		area->yorigin += ycoeff;
+		area->zorigin += zcoeff;
+		area->time += timestep;
+		area->SetOffsets(ctrl);
+		area->num_visible = (std::size_t)(area->num_flakes * EffectBudget.Scale(EFFECT_FLAKES));
+		Jobs.ParallelFor(snow_jobs, area->num_visible, FLAKE_JOB_SIZE, [area](std::size_t first, std::size_t last) {
+			area->Build(first, last);
+		});
 	}
 	snow_lastpos = ctrl->cpos;
 }
 
-void CFlakes::Draw(const CControl *ctrl) const {
+void CFlakes::Draw() {
+	CEffectBudget::Timer timer(EFFECT_FLAKES);
+	if (g_game.snow_id < 1 || areas.empty())
+		return;
+
+	ScopedRenderMode rm(PARTICLES);
+	Tex.BindTex(SNOW_PART);
+	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	glColor(Env.ParticleColor());
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 	for (std::size_t ar=0; ar<areas.size(); ar++)
-		areas[ar].Draw(ctrl);
+		areas[ar].Draw();
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+	if (HaveBufferObjects())
+		glBindBuffer_p(GL_ARRAY_BUFFER, 0);
 }
 
 // --------------------------------------------------------------------
@@ -698,9 +991,10 @@ struct TChange {
 TChange changes[NUM_CHANGES];
 
 void InitChanges() {
+	CRandom& rnd = RandomStream(RAND_WEATHER);
 	for (int i=0; i<NUM_CHANGES; i++) {
-		changes[i].min = XRandom(-0.15, -0.05);
-		changes[i].max = XRandom(0.05, 0.15);
+		changes[i].min = rnd.Range(-0.15, -0.05);
+		changes[i].max = rnd.Range(0.05, 0.15);
 		changes[i].curr = (changes[i].min + changes[i].max) / 2;
 		changes[i].step = CHANGE_SPEED;
 		changes[i].forward = true;
@@ -746,75 +1040,76 @@ TCurtain::TCurtain(int num_rows, float z_dist, float tex_size,
 	lastangle = startangle + (numCols-1) * angledist;
 
 	for (unsigned int i=0; i<numRows; i++)
-		chg[i] = IRandom(0, 5);
+		chg[i] = RandomStream(RAND_WEATHER).Int(0, 5);
 }
 
 void TCurtain::SetStartParams(const CControl* ctrl) {
-	for (unsigned int co=0; co<numCols; co++) {
-		for (unsigned int row=0; row<numRows; row++) {
-			TCurtainElement* curt = &curtains[co][row];
-			curt->height = minheight + row * size;
+	for (unsigned int row=0; row<numRows; row++) {
+		for (unsigned int co=0; co<numCols; co++) {
+			height[row][co] = minheight + row * size;
+			angle[row][co] = co * angledist + startangle;
 			float x, z;
-			curt->angle = co * angledist + startangle;
-			CurtainVec(curt->angle, zdist, x, z);
-			curt->pt.x = ctrl->cpos.x + x;
-			curt->pt.z = ctrl->cpos.z + z;
-			curt->pt.y = ctrl->cpos.y + curt->height;
+			CurtainVec(angle[row][co], zdist, x, z);
+			px[row][co] = ctrl->cpos.x + x;
+			pz[row][co] = ctrl->cpos.z + z;
+			py[row][co] = ctrl->cpos.y + height[row][co];
 		}
 	}
 }
 
-void TCurtain::Draw() const {
-	Tex.BindTex(texture);
+void TCurtain::Draw(const sf::Color& col) const {
+	RenderQueue.Begin(PARTICLES, Tex.GetTexture(texture));
+	RenderQueue.Color(col);
 	float halfsize = size / 2.f;
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-	for (unsigned int co=0; co<numCols; co++) {
-		for (unsigned int row=0; row<numRows; row++) {
-			const TVector3d& pt = curtains[co][row].pt;
-			glPushMatrix();
-			glTranslate(pt);
-			glRotatef(-curtains[co][row].angle, 0, 1, 0);
-
-			static const GLshort tex[] = {
-				0, 1,
-				1, 1,
-				1, 0,
-				0, 0
-			};
-			const GLfloat vtx[] = {
-				-halfsize, -halfsize, 0,
-				halfsize, -halfsize, 0,
-				halfsize, halfsize, 0,
-				-halfsize, halfsize, 0
-			};
-			glVertexPointer(3, GL_FLOAT, 0, vtx);
-			glTexCoordPointer(2, GL_SHORT, 0, tex);
-			glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-			glPopMatrix();
+	const TVector3d up(0, halfsize, 0);
+	for (unsigned int row=0; row<numRows; row++) {
+		for (unsigned int co=0; co<numCols; co++) {
+			const TVector3d pt(px[row][co], py[row][co], pz[row][co]);
+			double a = angle[row][co] * M_PI / 180.0;
+			TVector3d right(halfsize * std::cos(a), 0, halfsize * std::sin(a));
+
+			RenderQueue.Vertex(pt - right - up, 0, 1);
+			RenderQueue.Vertex(pt + right - up, 1, 1);
+			RenderQueue.Vertex(pt + right + up, 1, 0);
+			RenderQueue.Vertex(pt - right + up, 0, 0);
 		}
 	}
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-	glDisableClientState(GL_VERTEX_ARRAY);
+	RenderQueue.End();
 }
 
-void TCurtain::Update(float timestep, const TVector3d& drift, const CControl* ctrl) {
-	for (unsigned int co=0; co<numCols; co++) {
-		for (unsigned int row=0; row<numRows; row++) {
-			TCurtainElement* curt = &curtains[co][row];
-
-			curt->angle += changes[chg[row]].curr * timestep * CHANGE_DRIFT;
-			curt->angle += drift.x * timestep * CURTAIN_WINDDRIFT;
-			curt->height -= speed * timestep;
+// The wind is sampled at the last position of the elements. The angle and
+// height updates are plain loops over the columns of a row.
+void TCurtain::Update(float timestep, const TVector3d& pos) {
+	const float hiangle = lastangle + angledist;
+	const float loangle = startangle - angledist;
+	const float fall = speed * timestep;
+	const float lowest = minheight - size;
+	const float wrap = numRows * size;
+
+	for (unsigned int row=0; row<numRows; row++) {
+		float drift_x[MAX_CURTAIN_COLS];
+		float drift_z[MAX_CURTAIN_COLS];
+		Wind.SampleDrift(px[row], pz[row], numCols, drift_x, drift_z);
+
+		const float turn = changes[chg[row]].curr * timestep * CHANGE_DRIFT;
+		float* a = angle[row];
+		float* h = height[row];
+		float* y = py[row];
+		for (unsigned int co=0; co<numCols; co++) {
+			float na = a[co] + turn + drift_x[co] * timestep * CURTAIN_WINDDRIFT;
+			na = na > hiangle ? startangle : na;
+			a[co] = na < loangle ? lastangle : na;
+
+			float nh = h[co] - fall;
+			y[co] = (float)pos.y + nh;
+			h[co] = nh < lowest ? nh + wrap : nh;
+		}
 
-			if (curt->angle > lastangle + angledist) curt->angle = startangle;
-			if (curt->angle < startangle - angledist) curt->angle = lastangle;
+		for (unsigned int co=0; co<numCols; co++) {
 			float x, z;
-			CurtainVec(curt->angle, zdist, x, z);
-			curt->pt.x = ctrl->cpos.x + x;
-			curt->pt.z = ctrl->cpos.z + z;
-			curt->pt.y = ctrl->cpos.y + curt->height;
-			if (curt->height < minheight - size) curt->height += numRows * size;
+			CurtainVec(a[co], zdist, x, z);
+			px[row][co] = pos.x + x;
+			pz[row][co] = pos.z + z;
 		}
 	}
 }
@@ -827,29 +1122,33 @@ void TCurtain::CurtainVec(float angle, float zdist, float &x, float &z) {
 	else z = -std::sqrt(zdist * zdist - x * x);
 }
 
+// the effect budget thins the snow out by leaving out curtains
+std::size_t CCurtain::VisibleCurtains() const {
+	return (std::size_t)std::ceil(curtains.size() * EffectBudget.Scale(EFFECT_CURTAINS));
+}
+
 void CCurtain::Draw() {
 	if (g_game.snow_id < 1) return;
+	CEffectBudget::Timer timer(EFFECT_CURTAINS);
 
-	ScopedRenderMode rm(PARTICLES);
-	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-	const sf::Color& particle_colour = Env.ParticleColor();
-	glColor(particle_colour, 255);
-
-	// glEnable (GL_NORMALIZE);
-	for (std::size_t i=0; i<curtains.size(); i++) {
-		curtains[i].Draw();
+	sf::Color particle_colour = Env.ParticleColor();
+	particle_colour.a = 255;
+	std::size_t num = VisibleCurtains();
+	for (std::size_t i=0; i<num; i++) {
+		curtains[i].Draw(particle_colour);
 	}
 }
 
 void CCurtain::Update(float timestep, const CControl *ctrl) {
 	if (g_game.snow_id < 1) return;
-	const TVector3d& drift = Wind.WindDrift();
-
+	CEffectBudget::Timer timer(EFFECT_CURTAINS);
 	UpdateChanges(timestep);
-	for (std::size_t i=0; i<curtains.size(); i++) {
-		curtains[i].Update(timestep, drift, ctrl);
+	TVector3d pos = ctrl->cpos;
+	std::size_t num = VisibleCurtains();
+	for (std::size_t i=0; i<num; i++) {
+		TCurtain* curtain = &curtains[i];
+		Jobs.Submit(snow_jobs, [=] { curtain->Update(timestep, pos); });
 	}
-	Draw();
 }
 
 void CCurtain::Reset() {
@@ -911,6 +1210,8 @@ void CCurtain::Init(const CControl *ctrl) {
 // --------------------------------------------------------------------
 
 #define UPDATE_TIME 0.04f
+#define WIND_CELL_SIZE 12.f
+#define WIND_GUST_SPEED 0.2f	// relative to the wind drift
 
 CWind Wind;
 
@@ -918,6 +1219,7 @@ CWind::CWind()
 	: WVector(0, 0, 0) {
 	windy = false;
 	CurrTime = 0.0;
+	seed = 0;
 
 	SpeedMode = 0;
 	AngleMode = 0;
@@ -927,6 +1229,8 @@ CWind::CWind()
 	DestAngle = 0;
 	WindChange = 0;
 	AngleChange = 0;
+	std::fill(gusts, gusts + WIND_GRID_SIZE * WIND_GRID_SIZE, 1.f);
+	gust_offset_x = gust_offset_z = 0.f;
 }
 
 void CWind::SetParams(int grade) {
@@ -958,6 +1262,7 @@ void CWind::SetParams(int grade) {
 		params.topSpeed = 100;
 		params.topProbability = 0;
 		params.nullProbability = 6;
+		params.gustiness = 0.2f;
 		alt_angle = 180;
 	} else if (grade == 1) {
 		min_base_speed = 30;
@@ -977,6 +1282,7 @@ void CWind::SetParams(int grade) {
 		params.topSpeed = 100;
 		params.topProbability = 0;
 		params.nullProbability = 10;
+		params.gustiness = 0.35f;
 		alt_angle = 180;
 	} else {
 		min_base_speed = 40;
@@ -996,36 +1302,37 @@ void CWind::SetParams(int grade) {
 		params.topSpeed = 100;
 		params.topProbability = 10;
 		params.nullProbability = 10;
+		params.gustiness = 0.5f;
 		alt_angle = 0;
 	}
 
 	float speed, var, angle;
 
-	speed = XRandom(min_base_speed, max_base_speed);
-	var = XRandom(min_speed_var, max_speed_var) / 2;
+	speed = rnd.Range(min_base_speed, max_base_speed);
+	var = rnd.Range(min_speed_var, max_speed_var) / 2;
 	params.minSpeed = speed - var;
 	params.maxSpeed = speed + var;
 	if (params.minSpeed < 0) params.minSpeed = 0;
 	if (params.maxSpeed > 100) params.maxSpeed = 100;
 
-	angle = XRandom(min_base_angle, max_base_angle);
-	if (XRandom(0, 100) > 50) angle = angle + alt_angle;
-	var = XRandom(min_angle_var, max_angle_var) / 2;
+	angle = rnd.Range(min_base_angle, max_base_angle);
+	if (rnd.Range(0, 100) > 50) angle = angle + alt_angle;
+	var = rnd.Range(min_angle_var, max_angle_var) / 2;
 	params.minAngle = angle - var;
 	params.maxAngle = angle + var;
 }
 
 void CWind::CalcDestSpeed() {
-	float rand = XRandom(0, 100);
+	float rand = rnd.Range(0, 100);
 	if (rand > (100 - params.topProbability)) {
-		DestSpeed = XRandom(params.maxSpeed, params.topSpeed);
+		DestSpeed = rnd.Range(params.maxSpeed, params.topSpeed);
 		WindChange = params.maxChange;
 	} else if (rand < params.nullProbability) {
 		DestSpeed = 0.0;
-		WindChange = XRandom(params.minChange, params.maxChange);
+		WindChange = rnd.Range(params.minChange, params.maxChange);
 	} else {
-		DestSpeed = XRandom(params.minSpeed, params.maxSpeed);
-		WindChange = XRandom(params.minChange, params.maxChange);
+		DestSpeed = rnd.Range(params.minSpeed, params.maxSpeed);
+		WindChange = rnd.Range(params.minChange, params.maxChange);
 	}
 
 	if (DestSpeed > WSpeed) SpeedMode = 1;
@@ -1033,8 +1340,8 @@ void CWind::CalcDestSpeed() {
 }
 
 void CWind::CalcDestAngle() {
-	DestAngle = XRandom(params.minAngle, params.maxAngle);
-	AngleChange = XRandom(params.minAngleChange, params.maxAngleChange);
+	DestAngle = rnd.Range(params.minAngle, params.maxAngle);
+	AngleChange = rnd.Range(params.minAngleChange, params.maxAngleChange);
 
 	if (DestAngle > WAngle) AngleMode = 1;
 	else AngleMode = 0;
@@ -1043,6 +1350,11 @@ void CWind::CalcDestAngle() {
 void CWind::Update(float timestep) {
 	if (!windy) return;
 
+	// the gusts travel with the wind
+	const float period = WIND_GRID_SIZE * WIND_CELL_SIZE;
+	gust_offset_x = std::fmod(gust_offset_x + WVector.x * WIND_GUST_SPEED * timestep, period);
+	gust_offset_z = std::fmod(gust_offset_z + WVector.z * WIND_GUST_SPEED * timestep, period);
+
 	// the wind needn't be updated in each frame
 	CurrTime = CurrTime + timestep;
 	if (CurrTime > UPDATE_TIME) {
@@ -1084,7 +1396,74 @@ void CWind::Update(float timestep) {
 	}
 }
 
+// Random gust factors around 1, smoothed once so neighbouring cells differ
+// less.
+void CWind::InitGusts() {
+	float noise[WIND_GRID_SIZE * WIND_GRID_SIZE];
+	rnd.Fill(noise, WIND_GRID_SIZE * WIND_GRID_SIZE,
+	         1.f - params.gustiness, 1.f + params.gustiness);
+	const int mask = WIND_GRID_SIZE - 1;
+	for (int z = 0; z < WIND_GRID_SIZE; z++) {
+		for (int x = 0; x < WIND_GRID_SIZE; x++) {
+			float sum = 0.f;
+			for (int dz = -1; dz <= 1; dz++)
+				for (int dx = -1; dx <= 1; dx++)
+					sum += noise[((z + dz) & mask) * WIND_GRID_SIZE + ((x + dx) & mask)];
+			gusts[z * WIND_GRID_SIZE + x] = sum / 9.f;
+		}
+	}
+	gust_offset_x = gust_offset_z = 0.f;
+}
+
+// bilinear interpolation in the tiled grid
+float CWind::Gust(float x, float z) const {
+	float u = (x - gust_offset_x) * (1.f / WIND_CELL_SIZE);
+	float v = (z - gust_offset_z) * (1.f / WIND_CELL_SIZE);
+	float fu = std::floor(u);
+	float fv = std::floor(v);
+	float tu = u - fu;
+	float tv = v - fv;
+	const int mask = WIND_GRID_SIZE - 1;
+	int x0 = (int)fu & mask;
+	int z0 = (int)fv & mask;
+	int x1 = (x0 + 1) & mask;
+	int z1 = (z0 + 1) & mask;
+	float g0 = gusts[z0 * WIND_GRID_SIZE + x0] + tu * (gusts[z0 * WIND_GRID_SIZE + x1] - gusts[z0 * WIND_GRID_SIZE + x0]);
+	float g1 = gusts[z1 * WIND_GRID_SIZE + x0] + tu * (gusts[z1 * WIND_GRID_SIZE + x1] - gusts[z1 * WIND_GRID_SIZE + x0]);
+	return g0 + tv * (g1 - g0);
+}
+
+TVector3d CWind::DriftAt(const TVector3d& pos) const {
+	if (!windy) return TVector3d(0, 0, 0);
+	return (double)Gust(pos.x, pos.z) * WVector;
+}
+
+// Samples the horizontal drift at num positions. Only reads the state, so
+// it can be called from jobs while the wind isn't updated.
+void CWind::SampleDrift(const float* x, const float* z, std::size_t num, float* drift_x, float* drift_z) const {
+	if (!windy) {
+		std::fill(drift_x, drift_x + num, 0.f);
+		std::fill(drift_z, drift_z + num, 0.f);
+		return;
+	}
+	const float wx = WVector.x;
+	const float wz = WVector.z;
+	for (std::size_t i = 0; i < num; i++) {
+		float g = Gust(x[i], z[i]);
+		drift_x[i] = g * wx;
+		drift_z[i] = g * wz;
+	}
+}
+
 void CWind::Init(int wind_id) {
+	Init(wind_id, RandomStream(RAND_WEATHER).Next());
+}
+
+void CWind::Init(int wind_id, uint64_t seed_) {
+	seed = seed_;
+	rnd.Seed(seed);
+	CurrTime = 0.f;
+	WVector = TVector3d(0, 0, 0);
 	if (wind_id < 1 || wind_id > 3) {
 		windy = false;
 		WVector = TVector3d(0, 0, 0);
@@ -1094,8 +1473,9 @@ void CWind::Init(int wind_id) {
 	}
 	windy = true;;
 	SetParams(wind_id -1);
-	WSpeed = XRandom(params.minSpeed, (params.minSpeed + params.maxSpeed) / 2);
-	WAngle = XRandom(params.minAngle, params.maxAngle);
+	WSpeed = rnd.Range(params.minSpeed, (params.minSpeed + params.maxSpeed) / 2);
+	WAngle = rnd.Range(params.minAngle, params.maxAngle);
+	InitGusts();
 	CalcDestSpeed();
 	CalcDestAngle();
 }
@@ -1105,20 +1485,28 @@ void CWind::Init(int wind_id) {
 // ====================================================================
 
 void InitSnow(const CControl *ctrl) {
+	Jobs.Wait(snow_jobs);
 	if (g_game.snow_id < 1 || g_game.snow_id > 3) return;
 	Flakes.Init(g_game.snow_id, ctrl);
 	Curtain.Init(ctrl);
 }
 
+// The flakes and curtains are moved by parallel jobs, DrawSnow waits for them.
 void UpdateSnow(float timestep, const CControl *ctrl) {
+	Jobs.Wait(snow_jobs);
 	if (g_game.snow_id < 1 || g_game.snow_id > 3) return;
 	Flakes.Update(timestep, ctrl);
 	Curtain.Update(timestep, ctrl);
 }
 
 void DrawSnow(const CControl *ctrl) {
+	{
+		// the jobs are mostly flakes
+		CEffectBudget::Timer timer(EFFECT_FLAKES);
+		Jobs.Wait(snow_jobs);
+	}
 	if (g_game.snow_id < 1 || g_game.snow_id > 3) return;
-	Flakes.Draw(ctrl);
+	Flakes.Draw();
 	Curtain.Draw();
 }
 
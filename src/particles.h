@@ -38,23 +38,34 @@ void draw_ui_snow();
 void update_particles(float time_step);
 void clear_particles();
 void draw_particles(const CControl *ctrl);
-void generate_particles(const CControl *ctrl, double dtime, const TVector3d& pos, double speed);
+struct TParticleEmission {
+	TVector3d pos;
+	double dtime;
+	double speed;
+};
+
+void queue_particle_emission(double dtime, const TVector3d& pos, double speed);
+void emit_queued_particles(const CControl *ctrl);
+void take_queued_emissions(std::vector<TParticleEmission>& out);
+void emit_particles(const CControl *ctrl, const std::vector<TParticleEmission>& events);
 
 // --------------------------------------------------------------------
 //					snow flakes for short distances
 // --------------------------------------------------------------------
 
-struct TFlake {
-	TVector3d pt;
-	TVector3d vel;
-	float size;
-	const GLfloat* tex;
-
-	void Draw(const TPlane& lp, const TPlane& rp, bool rotate_flake, float dir_angle) const;
-};
-
+// The flakes of an area are uploaded once, relative to the area box. Their
+// positions are derived each frame from the accumulated offsets and the
+// falling time of the area, wrapped into the box that follows the player.
 struct TFlakeArea {
-	std::vector<TFlake> flakes;
+	std::size_t num_flakes;
+	std::size_t num_visible;	// first flakes drawn, set by the effect budget
+	std::vector<float> base_x;	// position inside the box at time 0
+	std::vector<float> base_y;
+	std::vector<float> base_z;
+	std::vector<float> fall;	// falling speed, negative
+	std::vector<float> size;
+	std::vector<GLfloat> texcoords;	// 4 corners per flake, static
+	std::vector<GLfloat> vertices;	// 4 corners per flake, rebuilt each frame
 
 	float left;
 	float right;
@@ -73,8 +84,23 @@ struct TFlakeArea {
 	float speed;
 	bool  rotate_flake;
 
+	// origin of the flake field in world space and the falling time
+	double xorigin;
+	double yorigin;
+	double zorigin;
+	double time;
+	// offsets of the field inside the current box, set by SetOffsets
+	float xshift;
+	float yshift;
+	float zshift;
+	float xaxis_x;
+	float xaxis_z;
+
+	GLuint tex_buffer;
+	GLuint vertex_buffer;
+
 	TFlakeArea(
-	    std::size_t num_flakes,
+	    std::size_t num_flakes_,
 	    float xrange_,
 	    float ytop_,
 	    float yrange_,
@@ -84,8 +110,10 @@ struct TFlakeArea {
 	    float maxSize_,
 	    float speed_,
 	    bool  rotate);
-	void Draw(const CControl* ctrl) const;
-	void Update(float timestep, float xcoeff, float ycoeff, float zcoeff);
+	void SetOffsets(const CControl* ctrl);
+	void Build(std::size_t first, std::size_t last);
+	void Draw();
+	void ReleaseBuffers();
 };
 
 class CFlakes {
@@ -99,7 +127,7 @@ public:
 	void Init(int grade, const CControl *ctrl);
 	void Reset();
 	void Update(float timestep, const CControl *ctrl);
-	void Draw(const CControl *ctrl) const;
+	void Draw();
 };
 
 // --------------------------------------------------------------------
@@ -114,15 +142,14 @@ public:
 #define MAX_CURTAIN_COLS 16
 #define MAX_CURTAIN_ROWS 8
 
-struct TCurtainElement {
-	TVector3d pt;
-	float angle;
-	float height;
-	float zrandom;
-};
-
+// The elements are stored by row, the columns of a row are contiguous
+// and updated in one loop.
 struct TCurtain {
-	TCurtainElement curtains[MAX_CURTAIN_COLS][MAX_CURTAIN_ROWS];
+	float angle[MAX_CURTAIN_ROWS][MAX_CURTAIN_COLS];
+	float height[MAX_CURTAIN_ROWS][MAX_CURTAIN_COLS];
+	float px[MAX_CURTAIN_ROWS][MAX_CURTAIN_COLS];
+	float py[MAX_CURTAIN_ROWS][MAX_CURTAIN_COLS];
+	float pz[MAX_CURTAIN_ROWS][MAX_CURTAIN_COLS];
 	int chg[MAX_CURTAIN_ROWS];	// for each row
 
 	unsigned int numCols;
@@ -145,8 +172,8 @@ struct TCurtain {
 	    float min_height,
 	    int dense);
 	void SetStartParams(const CControl* ctrl);
-	void Draw() const;
-	void Update(float timestep, const TVector3d& drift, const CControl* ctrl);
+	void Draw(const sf::Color& col) const;
+	void Update(float timestep, const TVector3d& pos);
 
 private:
 	static void CurtainVec(float angle, float zdist, float &x, float &z);
@@ -157,6 +184,7 @@ private:
 	std::vector<TCurtain> curtains;
 
 	void SetStartParams(const CControl *ctrl);
+	std::size_t VisibleCurtains() const;
 public:
 	void Init(const CControl *ctrl);
 	void Update(float timestep, const CControl *ctrl);
@@ -182,8 +210,14 @@ struct TWindParams {
 	float topSpeed;
 	float topProbability;
 	float nullProbability;
+	float gustiness;	// relative variation of the wind field
 };
 
+// The wind has a global speed and direction. It is modulated by a small
+// tiled grid of gust factors, which drifts with the wind, so the drift
+// varies across the course.
+#define WIND_GRID_SIZE 16	// cells per side, power of 2
+
 class CWind {
 private:
 	bool windy;
@@ -202,18 +236,33 @@ private:
 	float WindChange;
 	float AngleChange;
 
+	float gusts[WIND_GRID_SIZE * WIND_GRID_SIZE];
+	float gust_offset_x;
+	float gust_offset_z;
+	// seeded from the weather stream, a copy of the wind can be updated
+	// on another thread
+	CRandom rnd;
+	uint64_t seed;
+
 	void SetParams(int grade);
 	void CalcDestSpeed();
 	void CalcDestAngle();
+	void InitGusts();
+	float Gust(float x, float z) const;
 public:
 	CWind();
 
 	void Update(float timestep);
 	void Init(int wind_id);
+	// the same seed gives the same wind, as for a replay
+	void Init(int wind_id, uint64_t seed_);
+	uint64_t Seed() const { return seed; }
 	bool Windy() const { return windy; }
 	float Angle() const { return WAngle; }
 	float Speed() const { return WSpeed; }
 	const TVector3d& WindDrift() const { return WVector; }
+	TVector3d DriftAt(const TVector3d& pos) const;
+	void SampleDrift(const float* x, const float* z, std::size_t num, float* drift_x, float* drift_z) const;
 };
 
 extern CWind Wind;
@@ -34,6 +34,7 @@ GNU General Public License for more details.
 #include "racing.h"
 #include "winsys.h"
 #include "physics.h"
+#include "render_queue.h"
 
 CPaused Paused;
 
@@ -87,10 +88,12 @@ void CPaused::Loop(float time_step) {
 	if (terr) RenderCourse();
 	DrawTrackmarks();
 	if (trees) DrawTrees();
+	RenderQueue.Flush();
 
 	DrawSnow(ctrl);
+	RenderQueue.Flush();
 
-	if (param.perf_level > 2) draw_particles(ctrl);
+	draw_particles(ctrl);
 	g_game.character->shape->Draw();
 
 	DrawHud(ctrl);
@@ -25,7 +25,7 @@ GNU General Public License for more details.
 #include "audio.h"
 #include "particles.h"
 #include "game_ctrl.h"
-#include "game_over.h"
+#include "telemetry.h"
 #include <algorithm>
 
 CControl::CControl() :
@@ -40,6 +40,11 @@ CControl::CControl() :
 	jumping = false;
 	jump_charging = false;
 	last_pos = cpos;
+	prev_pos = cpos;
+	prev_valid = false;
+	draw_alpha = 1.0;
+	sim = nullptr;
+	game_over = false;
 	orientation_initialized = false;
 	cairborne = false;
 	way = 0.0;
@@ -81,6 +86,10 @@ void CControl::Init() {
 	cpos.y = Course.FindYCoord(cpos.x, cpos.z);
 	cvel = init_vel;
 	last_pos = cpos;
+	prev_pos = cpos;
+	prev_valid = false;
+	draw_alpha = 1.0;
+	game_over = false;
 	cnet_force = TVector3d(0, 0, 0);
 	orientation_initialized = false;
 	plane_nml = nml;
@@ -130,6 +139,7 @@ bool CControl::CheckTreeCollisions(const TVector3d& pos, TVector3d *tree_loc) co
 		double squared_dist = (diam / 2.0 + 0.6);
 		squared_dist *= squared_dist;
 		if (MAG_SQD(distvec) > squared_dist) continue;
+		Telemetry.Add(CNT_COLLISION_TESTS);
 
 		TPolyhedron ph2 = Course.GetPoly(Course.CollArr[i].tree_type);
 		mat.SetScalingMatrix(diam, height, diam);
@@ -137,7 +147,7 @@ bool CControl::CheckTreeCollisions(const TVector3d& pos, TVector3d *tree_loc) co
 		mat.SetTranslationMatrix(loc.x, loc.y, loc.z);
 		TransPolyhedron(mat, ph2);
 
-		hit = g_game.character->shape->Collision(pos, ph2);
+		hit = Shape()->Collision(pos, ph2);
 		if (hit == true) {
 			if (tree_loc != nullptr) *tree_loc = loc;
 			Sound.Play("tree_hit", 0);
@@ -182,7 +192,9 @@ void CControl::CheckItemCollection(const TVector3d& pos) {
 	std::size_t num_items = Course.NocollArr.size();
 
 	for (std::size_t i=0; i<num_items; i++) {
-		if (Course.NocollArr[i].collectable != 1) continue;
+		// a simulation thread keeps its own flags, the renderer reads the course
+		int& collectable = sim ? sim->items[i] : Course.NocollArr[i].collectable;
+		if (collectable != 1) continue;
 
 		double diam = Course.NocollArr[i].diam;
 		const TVector3d& loc = Course.NocollArr[i].pt;
@@ -191,7 +203,8 @@ void CControl::CheckItemCollection(const TVector3d& pos) {
 		double squared_dist = (diam / 2. + 0.7);
 		squared_dist *= squared_dist;
 		if (MAG_SQD(distvec) <= squared_dist) {  // Check collision using a bounding sphere
-			Course.NocollArr[i].collectable = 0;
+			collectable = 0;
+			if (sim) sim->collected.push_back(i);
 			g_game.herring += 1;
 			Sound.Play("pickup1", 0);
 			Sound.Play("pickup2", 0);
@@ -210,7 +223,7 @@ void CControl::AdjustVelocity() {
 
 	if (g_game.finish == true) {
 /// --------------- finish ------------------------------------
-		if (speed < 3) State::manager.RequestEnterState(GameOver);
+		if (speed < 3) game_over = true;
 /// -----------------------------------------------------------
 	}
 }
@@ -223,7 +236,7 @@ void CControl::AdjustPosition(const TPlane& surf_plane, double dist_from_surface
 }
 
 void CControl::SetTuxPosition(double speed) {
-	CCharShape *shape = g_game.character->shape;
+	CCharShape *shape = Shape();
 
 	TVector2d playSize = Course.GetPlayDimensions();
 	TVector2d courseSize = Course.GetDimensions();
@@ -239,7 +252,7 @@ void CControl::SetTuxPosition(double speed) {
 				g_game.finish = true;
 				finish_speed = speed;
 //				SetStationaryCamera (true);
-			} else State::manager.RequestEnterState(GameOver);
+			} else game_over = true;
 		}
 /// -----------------------------------------------------------
 	}
@@ -271,8 +284,10 @@ const double airdrag[] = {2.25, 1.35, 0.6, 0, -0.35, -0.45, -0.33, -0.9};
 
 TVector3d CControl::CalcAirForce() {
 	TVector3d windvec = -ff.vel;
-	if (g_game.wind_id > 0)
-		windvec += WIND_FACTOR * Wind.WindDrift();
+	if (g_game.wind_id > 0) {
+		const CWind& wind = sim ? *sim->wind : Wind;
+		windvec += WIND_FACTOR * wind.DriftAt(ff.pos);
+	}
 
 	double windspeed = windvec.Length();
 	double re = 34600 * windspeed;
@@ -477,6 +492,7 @@ void CControl::SolveOdeSystem(double timestep) {
 
 		bool failed = false;
 		for (;;) {
+			Telemetry.Add(CNT_ODE_STEPS);
 			solver.InitOdeData(&x, new_pos.x, h);
 			solver.InitOdeData(&y, new_pos.y, h);
 			solver.InitOdeData(&z, new_pos.z, h);
@@ -563,7 +579,7 @@ void CControl::SolveOdeSystem(double timestep) {
 
 		t = t + h;
 		double speed = new_vel.Length();
-		if (param.perf_level > 2) generate_particles(this, h, new_pos, speed);
+		queue_particle_emission(h, new_pos, speed);
 
 		new_f = CalcNetForce(new_pos, new_vel);
 
@@ -593,7 +609,7 @@ void CControl::SolveOdeSystem(double timestep) {
 // --------------------------------------------------------------------
 
 void CControl::UpdatePlayerPos(float timestep) {
-	CCharShape *shape = g_game.character->shape;
+	CCharShape *shape = Shape();
 	double paddling_factor;
 	double flap_factor;
 	double dist_from_surface;
@@ -644,3 +660,55 @@ void CControl::UpdatePlayerPos(float timestep) {
 	shape->AdjustJoints(turn_animation, is_braking, paddling_factor, speed,
 	                    local_force, flap_factor);
 }
+
+// --------------------------------------------------------------------
+//			interpolation for drawing
+// --------------------------------------------------------------------
+
+CCharShape* CControl::Shape() const {
+	return sim ? sim->shape : g_game.character->shape;
+}
+
+// Takes over the state of the simulation, but keeps the camera and the
+// context of this control.
+void CControl::CopySimState(const CControl& src) {
+	TVector3d keep_viewpos = viewpos;
+	TVector3d keep_plyr_pos = plyr_pos;
+	TVector3d keep_viewdir = viewdir;
+	TVector3d keep_viewup = viewup;
+	TMatrix<4, 4> keep_view_mat = view_mat;
+	TViewMode keep_viewmode = viewmode;
+	bool keep_view_init = view_init;
+	TSimContext *keep_sim = sim;
+
+	*this = src;
+
+	viewpos = keep_viewpos;
+	plyr_pos = keep_plyr_pos;
+	viewdir = keep_viewdir;
+	viewup = keep_viewup;
+	view_mat = keep_view_mat;
+	viewmode = keep_viewmode;
+	view_init = keep_view_init;
+	sim = keep_sim;
+}
+
+void CControl::BeginStep() {
+	prev_pos = cpos;
+	prev_orientation = corientation;
+	prev_valid = orientation_initialized;
+}
+
+// The physics runs with a fixed step, the frames are drawn in between.
+// alpha is the part of the step that has passed since the last step.
+void CControl::Interpolate(double alpha) {
+	draw_alpha = prev_valid ? clamp(0.0, alpha, 1.0) : 1.0;
+	if (!orientation_initialized) return;
+
+	TQuaternion orientation = prev_valid
+	                          ? InterpolateQuaternions(prev_orientation, corientation, draw_alpha)
+	                          : corientation;
+	TVector3d pos = DrawPos();
+	pos.y += TUX_Y_CORR;
+	g_game.character->shape->PlaceRoot(pos, orientation, roll_factor, flip_factor);
+}
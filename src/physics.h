@@ -20,6 +20,7 @@ GNU General Public License for more details.
 
 #include "bh.h"
 #include "mathlib.h"
+#include <vector>
 
 #define MAX_PADDLING_SPEED (60.0 / 3.6)
 #define PADDLE_FACT 1.0
@@ -75,15 +76,27 @@ struct TForce {
 	double compression;
 };
 
+class CCharShape;
+class CWind;
+
+// The objects a simulation thread owns instead of the shared ones, see
+// sim_thread.h. Without a context the physics uses the globals.
+struct TSimContext {
+	CCharShape *shape;
+	const CWind *wind;
+	std::vector<int> items;		// collectable flags of Course.NocollArr
+	std::vector<std::size_t> collected;	// items collected since the last snapshot
+};
+
 class CControl {
 private:
 	TForce ff;
 	double ode_time_step;
 	double finish_speed;
 
-	bool CheckTreeCollisions(const TVector3d& pos, TVector3d *tree_loc) const;
 	void AdjustTreeCollision(const TVector3d& pos, TVector3d *vel) const;
-	static void CheckItemCollection(const TVector3d& pos);
+	void CheckItemCollection(const TVector3d& pos);
+	CCharShape* Shape() const;
 
 	TVector3d CalcRollNormal(double speed);
 	TVector3d CalcAirForce();
@@ -104,6 +117,8 @@ private:
 public:
 	CControl();
 
+	bool CheckTreeCollisions(const TVector3d& pos, TVector3d *tree_loc) const;
+
 	// view:
 	TVector3d viewpos;
 	TVector3d plyr_pos;
@@ -150,8 +165,22 @@ public:
 	double minSpeed;
 	double minFrictspeed;
 
+	// state before the last simulation step, the shape and the view are
+	// drawn between this and the current state
+	TVector3d prev_pos;
+	TQuaternion prev_orientation;
+	bool prev_valid;
+	double draw_alpha;		// 0 = previous step, 1 = current step
+
+	TSimContext *sim;	// nullptr if the physics runs on the main thread
+	bool game_over;		// set by the physics when the race has ended
+
 	void Init();
 	void UpdatePlayerPos(float timestep);
+	void BeginStep();
+	void Interpolate(double alpha);
+	TVector3d DrawPos() const { return prev_pos + draw_alpha * (cpos - prev_pos); }
+	void CopySimState(const CControl& src);
 };
 
 #endif
@@ -0,0 +1,264 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "profiler.h"
+#include "ogl.h"
+#include "font.h"
+#include "winsys.h"
+#include "game_config.h"
+#include "frame_pacer.h"
+#include "spx.h"
+#include <algorithm>
+
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+
+CProfiler Profiler;
+
+static const char* stage_names[NUM_PROF_STAGES] = {
+	"physics", "view", "course", "tracks", "trees",
+	"particles", "tux", "snow", "hud", "swap"
+};
+
+CProfiler::CProfiler() {
+	overlay = false;
+	active_gl = false;
+	history_count = 0;
+	history_pos = 0;
+	frame_number = 0;
+	query_frame = 0;
+	open_query = -1;
+	for (std::size_t f = 0; f < PROF_QUERY_FRAMES; f++) {
+		pending_valid[f] = false;
+		for (int s = 0; s < NUM_PROF_STAGES; s++) {
+			queries[f][s] = 0;
+			query_used[f][s] = false;
+		}
+	}
+	for (int s = 0; s < NUM_PROF_STAGES; s++) {
+		current.cpu[s] = 0.f;
+		current.gpu[s] = -1.f;
+	}
+	current.frame = 0.f;
+	current.latency = -1.f;
+	current.number = 0;
+}
+
+CProfiler::~CProfiler() {
+	if (log.is_open()) log.close();
+}
+
+void CProfiler::ToggleLog() {
+	if (log.is_open()) {
+		log.close();
+		return;
+	}
+
+	std::string path = param.save_dir + SEP "profile_" + GetTimeString() + ".csv";
+	log.open(path.c_str());
+	if (!log) {
+		Message("could not open profile log", path);
+		return;
+	}
+	log << "frame,frame_ms,input_ms";
+	for (int s = 0; s < NUM_PROF_STAGES; s++)
+		log << ',' << stage_names[s] << "_cpu";
+	for (int s = 0; s < NUM_PROF_STAGES; s++)
+		log << ',' << stage_names[s] << "_gpu";
+	log << '\n';
+}
+
+// Forgets the frames measured so far, called at the start of a race.
+void CProfiler::Reset() {
+	history_count = 0;
+	history_pos = 0;
+	for (std::size_t f = 0; f < PROF_QUERY_FRAMES; f++)
+		pending_valid[f] = false;
+}
+
+void CProfiler::BeginFrame() {
+	if (!Active())
+		return;
+
+	if (!active_gl && HaveTimerQueries()) {
+		for (std::size_t f = 0; f < PROF_QUERY_FRAMES; f++)
+			glGenQueries_p(NUM_PROF_STAGES, queries[f]);
+		active_gl = true;
+	}
+
+	query_frame = frame_number % PROF_QUERY_FRAMES;
+	if (pending_valid[query_frame])
+		CollectQueries(query_frame);
+	for (int s = 0; s < NUM_PROF_STAGES; s++) {
+		query_used[query_frame][s] = false;
+		current.cpu[s] = 0.f;
+		current.gpu[s] = -1.f;
+	}
+	current.latency = -1.f;
+	open_query = -1;
+}
+
+void CProfiler::EndFrame(float frame_time) {
+	if (!Active())
+		return;
+
+	current.frame = frame_time * 1000.f;
+	current.number = frame_number++;
+	if (active_gl) {
+		pending[query_frame] = current;
+		pending_valid[query_frame] = true;
+	} else {
+		FinishFrame(current);
+	}
+}
+
+// Only the first scope of a stage in a frame gets a GL query, and queries
+// can't overlap, so a stage started within another one is CPU-only.
+void CProfiler::Begin(TProfileStage stage, bool gpu) {
+	if (!gpu || !active_gl || open_query >= 0 || query_used[query_frame][stage])
+		return;
+	glBeginQuery_p(GL_TIME_ELAPSED, queries[query_frame][stage]);
+	query_used[query_frame][stage] = true;
+	open_query = stage;
+}
+
+void CProfiler::End(TProfileStage stage, float ms) {
+	current.cpu[stage] += ms;
+	if (open_query == stage) {
+		glEndQuery_p(GL_TIME_ELAPSED);
+		open_query = -1;
+	}
+}
+
+// The slot is reused after PROF_QUERY_FRAMES frames, by then the results
+// are normally available and reading them doesn't stall.
+void CProfiler::CollectQueries(std::size_t slot) {
+	TFrame& frame = pending[slot];
+	for (int s = 0; s < NUM_PROF_STAGES; s++) {
+		if (!query_used[slot][s]) continue;
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v_p(queries[slot][s], GL_QUERY_RESULT, &ns);
+		frame.gpu[s] = ns / 1000000.f;
+	}
+	FinishFrame(frame);
+	pending_valid[slot] = false;
+}
+
+void CProfiler::FinishFrame(const TFrame& frame) {
+	history[history_pos] = frame;
+	history_pos = (history_pos + 1) % PROF_HISTORY;
+	history_count = std::min(history_count + 1, (std::size_t)PROF_HISTORY);
+
+	if (!log.is_open())
+		return;
+	log << frame.number << ',' << frame.frame << ',';
+	if (frame.latency >= 0.f) log << frame.latency;
+	for (int s = 0; s < NUM_PROF_STAGES; s++)
+		log << ',' << frame.cpu[s];
+	for (int s = 0; s < NUM_PROF_STAGES; s++) {
+		log << ',';
+		if (frame.gpu[s] >= 0.f) log << frame.gpu[s];
+	}
+	log << '\n';
+}
+
+// stage < 0 is the whole frame, NUM_PROF_STAGES the input latency
+float CProfiler::Percentile(int stage, bool gpu, float p) const {
+	float values[PROF_HISTORY];
+	std::size_t num = 0;
+	for (std::size_t i = 0; i < history_count; i++) {
+		const TFrame& frame = history[i];
+		float value = stage < 0 ? frame.frame
+		              : stage == NUM_PROF_STAGES ? frame.latency
+		              : gpu ? frame.gpu[stage] : frame.cpu[stage];
+		if (value >= 0.f) values[num++] = value;
+	}
+	if (num == 0) return -1.f;
+
+	std::size_t n = std::min((std::size_t)(p * num), num - 1);
+	std::nth_element(values, values + n, values + num);
+	return values[n];
+}
+
+void CProfiler::DrawOverlay() const {
+	if (!overlay)
+		return;
+
+	const unsigned int size = 14;
+	const float line = size + 4.f;
+	float y = 60.f;
+
+	Winsys.beginSFML();
+	FT.SetColor(colYellow);
+	FT.DrawString(10, y, "stage      cpu p50/p95/p99     gpu p50/p95/p99 (ms)", "normal", size);
+	y += line;
+	for (int s = -1; s < NUM_PROF_STAGES; s++) {
+		std::string text = s < 0 ? "frame" : stage_names[s];
+		text.resize(11, ' ');
+		for (int g = 0; g < 2; g++) {
+			if (s < 0 && g == 1) break;
+			float p50 = Percentile(s, g == 1, 0.5f);
+			if (p50 < 0.f) {
+				text += "   -";
+			} else {
+				text += Float_StrN(p50, 2) + " / ";
+				text += Float_StrN(Percentile(s, g == 1, 0.95f), 2) + " / ";
+				text += Float_StrN(Percentile(s, g == 1, 0.99f), 2);
+			}
+			text += "     ";
+		}
+		FT.SetColor(s < 0 ? colYellow : colWhite);
+		FT.DrawString(10, y, text, "normal", size);
+		y += line;
+	}
+	float p50 = Percentile(NUM_PROF_STAGES, false, 0.5f);
+	if (p50 >= 0.f) {
+		FT.SetColor(colYellow);
+		FT.DrawString(10, y, "input      " + Float_StrN(p50, 2) + " / "
+		              + Float_StrN(Percentile(NUM_PROF_STAGES, false, 0.95f), 2) + " / "
+		              + Float_StrN(Percentile(NUM_PROF_STAGES, false, 0.99f), 2), "normal", size);
+		y += line;
+	}
+	TPacerStats pacing = FramePacer.Stats();
+	FT.SetColor(colYellow);
+	FT.DrawString(10, y, "pacing     target " + Float_StrN(pacing.target, 2)
+	              + "  jitter " + Float_StrN(pacing.jitter, 2)
+	              + "  max " + Float_StrN(pacing.max_dev, 2)
+	              + "  spin " + Float_StrN(pacing.spin, 2)
+	              + "  late " + Int_StrN((int)pacing.late) + '/' + Int_StrN((int)pacing.frames)
+	              + (Winsys.VerticalSync() ? "  vsync" : ""), "normal", size);
+	y += line;
+	if (log.is_open()) {
+		FT.SetColor(colRed);
+		FT.DrawString(10, y, "recording", "normal", size);
+	}
+	Winsys.endSFML();
+}
+
+CProfiler::Scope::Scope(TProfileStage s, bool gpu)
+	: stage(s) {
+	if (Profiler.Active()) Profiler.Begin(stage, gpu);
+}
+
+CProfiler::Scope::~Scope() {
+	if (Profiler.Active()) Profiler.End(stage, clock.getElapsedTime().asMicroseconds() / 1000.f);
+}
@@ -0,0 +1,110 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+/* --------------------------------------------------------------------
+Frame profiler for the race. Each stage of a frame is measured with a
+CPU timer and, where available, a GL timer query. The latency from an
+input event to the buffer swap of the first frame showing its result is
+measured with the input clock. The overlay shows
+rolling percentiles of the last frames, and the recording writes one
+CSV line per frame to the save directory.
+--------------------------------------------------------------------- */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "bh.h"
+#include <fstream>
+
+enum TProfileStage {
+	PROF_PHYSICS,
+	PROF_VIEW,
+	PROF_COURSE,
+	PROF_TRACKS,
+	PROF_TREES,
+	PROF_PARTICLES,
+	PROF_TUX,
+	PROF_SNOW,
+	PROF_HUD,
+	PROF_SWAP,
+	NUM_PROF_STAGES
+};
+
+#define PROF_HISTORY 128	// frames of the rolling percentiles
+#define PROF_QUERY_FRAMES 4	// GL queries in flight
+
+class CProfiler {
+private:
+	struct TFrame {
+		float cpu[NUM_PROF_STAGES];	// ms
+		float gpu[NUM_PROF_STAGES];	// ms, negative if not measured
+		float frame;
+		float latency;	// ms, negative if no input was shown
+		std::size_t number;
+	};
+
+	bool overlay;
+	bool active_gl;		// timer queries available and created
+	TFrame current;
+	TFrame history[PROF_HISTORY];
+	std::size_t history_count;
+	std::size_t history_pos;	// next slot of the ring
+	std::size_t frame_number;
+
+	// the GL results arrive some frames later, the frames wait here
+	GLuint queries[PROF_QUERY_FRAMES][NUM_PROF_STAGES];
+	bool query_used[PROF_QUERY_FRAMES][NUM_PROF_STAGES];
+	TFrame pending[PROF_QUERY_FRAMES];
+	bool pending_valid[PROF_QUERY_FRAMES];
+	std::size_t query_frame;
+	int open_query;		// stage with a running query or -1
+
+	std::ofstream log;
+
+	void FinishFrame(const TFrame& frame);
+	void CollectQueries(std::size_t slot);
+	float Percentile(int stage, bool gpu, float p) const;
+public:
+	CProfiler();
+	~CProfiler();
+
+	bool Active() const { return overlay || log.is_open(); }
+	void ToggleOverlay() { overlay = !overlay; }
+	void ToggleLog();
+	void Reset();
+
+	void BeginFrame();
+	void EndFrame(float frame_time);
+	void Begin(TProfileStage stage, bool gpu);
+	void End(TProfileStage stage, float ms);
+	void Latency(float ms) { current.latency = ms; }
+	void DrawOverlay() const;
+
+	// measures the lifetime of the object, a stage can have several
+	// scopes per frame; scopes without GL calls pass gpu = false
+	class Scope {
+		TProfileStage stage;
+		sf::Clock clock;
+	public:
+		explicit Scope(TProfileStage s, bool gpu = true);
+		~Scope();
+	};
+};
+
+extern CProfiler Profiler;
+
+#endif
@@ -7,9 +7,14 @@
 #include "textures.h"
 #include "course.h"
 #include "ogl.h"
+#include "telemetry.h"
 
 #include <climits>
 #include <cstring>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #define TERRAIN_ERROR_SCALE 0.1f
 #define VERTEX_FORCE_THRESHOLD 100
@@ -19,7 +24,7 @@
 #define colorval(j,ch) \
 	VNCArray[j*STRIDE_GL_ARRAY+STRIDE_GL_ARRAY-4+(ch)]
 
-#define setalphaval(i) colorval(VertexIndices[i], 3) = \
+#define setalphaval(i) if (VNCArray) colorval(VertexIndices[i], 3) = \
 	( terrain <= VertexTerrains[i] ) ? 255 : 0
 
 #define update_min_max( idx ) \
@@ -61,6 +66,9 @@ GLuint *quadsquare::VertexArrayIndices = nullptr;
 GLuint quadsquare::VertexArrayCounter;
 GLuint quadsquare::VertexArrayMinIdx;
 GLuint quadsquare::VertexArrayMaxIdx;
+bool quadsquare::MeshChanged = true;
+bool quadsquare::BlendTerrains = false;
+TViewFrustum quadsquare::Frustum;
 
 quadsquare::quadsquare(quadcornerdata* pcd) {
 	pcd->Square = this;
@@ -386,6 +394,7 @@ void quadsquare::ResetTree() {
 	SubEnabledCount[0] = 0;
 	SubEnabledCount[1] = 0;
 	Dirty = true;
+	MeshChanged = true;
 }
 
 
@@ -476,6 +485,7 @@ void quadsquare::EnableEdgeVertex(int index, bool IncrementCount, const quadcorn
 	if ((EnabledFlags & (1 << index)) && IncrementCount == false) return;
 
 	EnabledFlags |= 1 << index;
+	MeshChanged = true;
 	if (IncrementCount == true && (index == 0 || index == 3)) {
 		SubEnabledCount[index & 1]++;
 	}
@@ -537,6 +547,8 @@ void quadsquare::CreateChild(int index, const quadcornerdata& cd) {
 void quadsquare::EnableChild(int index, const quadcornerdata& cd) {
 	if ((EnabledFlags & (16 << index)) == 0) {
 		EnabledFlags |= (16 << index);
+		Telemetry.Add(CNT_QUADTREE_NODES);
+		MeshChanged = true;
 		EnableEdgeVertex(index, true, cd);
 		EnableEdgeVertex((index + 1) & 3, true, cd);
 
@@ -548,6 +560,8 @@ void quadsquare::EnableChild(int index, const quadcornerdata& cd) {
 
 void quadsquare::NotifyChildDisable(const quadcornerdata& cd, int index) {
 	EnabledFlags &= ~(16 << index);
+	MeshChanged = true;
+	Telemetry.Add(CNT_QUADTREE_NODES, -1);
 	quadsquare*	s;
 
 	if (index & 2) s = this;
@@ -608,10 +622,12 @@ bool quadsquare::BoxTest(int x, int z, float size, float miny, float maxy, float
 	return false;
 }
 
-void quadsquare::Update(const quadcornerdata& cd, const TVector3d& ViewerLocation, float Detail) {
+void quadsquare::Update(const quadcornerdata& cd, const TVector3d& ViewerLocation,
+                        float Detail, const TViewFrustum& frustum) {
 	float Viewer[3];
 
 	DetailThreshold = Detail;
+	Frustum = frustum;
 	Viewer[0] = ViewerLocation.x / ScaleX;
 	Viewer[1] = ViewerLocation.y;
 	Viewer[2] = ViewerLocation.z / ScaleZ;
@@ -688,6 +704,7 @@ void quadsquare::UpdateAux(const quadcornerdata& cd,
 	        VertexTest(cd.xorg + whole, Vertex[1].Y, cd.zorg + half,
 	                   Error[0], ViewerLocation, cd.Level, East) == false) {
 		EnabledFlags &= ~1;
+		MeshChanged = true;
 		quadsquare*	s = GetNeighbor(0, cd);
 		if (s) s->EnabledFlags &= ~4;
 	}
@@ -697,6 +714,7 @@ void quadsquare::UpdateAux(const quadcornerdata& cd,
 	        VertexTest(cd.xorg + half, Vertex[4].Y, cd.zorg + whole,
 	                   Error[1], ViewerLocation, cd.Level, South) == false) {
 		EnabledFlags &= ~8;
+		MeshChanged = true;
 		quadsquare*	s = GetNeighbor(3, cd);
 		if (s) s->EnabledFlags &= ~2;
 	}
@@ -723,6 +741,7 @@ void quadsquare::InitVert(int i, int x, int z) {
 }
 
 GLubyte *VNCArray;
+static std::size_t rendered_triangles = 0;
 
 void quadsquare::DrawTris() {
 	int tmp_min_idx = VertexArrayMinIdx;
@@ -735,6 +754,8 @@ void quadsquare::DrawTris() {
 	glDrawElements(GL_TRIANGLES, VertexArrayCounter,
 	               GL_UNSIGNED_INT, VertexArrayIndices);
 	if (glUnlockArraysEXT_p) glUnlockArraysEXT_p();
+	rendered_triangles += VertexArrayCounter / 3;
+	num_draw_calls++;
 }
 
 void quadsquare::InitArrayCounters() {
@@ -745,6 +766,8 @@ void quadsquare::InitArrayCounters() {
 
 void quadsquare::Render(const quadcornerdata& cd, GLubyte *vnc_array) {
 	VNCArray = vnc_array;
+	BlendTerrains = param.perf_level > 1;
+	Frustum = GetViewFrustum();
 
 	std::size_t numTerrains = Course.TerrList.size();
 	for (std::size_t j=0; j<numTerrains; j++) {
@@ -758,7 +781,7 @@ void quadsquare::Render(const quadcornerdata& cd, GLubyte *vnc_array) {
 		}
 	}
 
-	if (param.perf_level > 1) {
+	if (BlendTerrains) {
 		InitArrayCounters();
 		RenderAux(cd, SomeClip, -1);
 
@@ -797,6 +820,40 @@ void quadsquare::Render(const quadcornerdata& cd, GLubyte *vnc_array) {
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
+// Collects the triangles of one terrain pass (-1 for the special pass)
+// without clipping and without touching the colour bytes of the vertex
+// array, appended to VertexArrayIndices. The triangles are grouped in
+// blocks: the squares of block_level, and the larger squares for their
+// own triangles. block_done is called after each block, in the same
+// order for every pass.
+void quadsquare::CollectBlocks(const quadcornerdata& cd, int terrain, int block_level,
+                               block_func_t block_done) {
+	if (cd.xorg >= RowSize-1 || cd.zorg >= NumRows-1)
+		return;
+	VNCArray = nullptr;
+	if (cd.Level <= block_level) {
+		RenderAux(cd, NoClip, terrain);
+		block_done(cd, MinY, MaxY);
+		return;
+	}
+
+	int	flags = 0;
+	int	mask = 1;
+	quadcornerdata	q;
+	for (int i = 0; i < 4; i++, mask <<= 1) {
+		if (EnabledFlags & (16 << i)) {
+			SetupCornerData(&q, cd, i);
+			Child[i]->CollectBlocks(q, terrain, block_level, block_done);
+		} else {
+			flags |= mask;
+		}
+	}
+	if (flags == 0) return;
+
+	EmitTris(cd, flags, terrain);
+	block_done(cd, MinY, MaxY);
+}
+
 clip_result_t quadsquare::ClipSquare(const quadcornerdata& cd) {
 	if (cd.xorg >= RowSize-1) {
 		return NotVisible;
@@ -822,7 +879,7 @@ clip_result_t quadsquare::ClipSquare(const quadcornerdata& cd) {
 	if (minimum.z > maximum.z)
 		std::swap(minimum.z, maximum.z);
 
-	clip_result_t clip_result = clip_aabb_to_view_frustum(minimum, maximum);
+	clip_result_t clip_result = Frustum.Clip(minimum, maximum);
 
 	if (clip_result == NotVisible || clip_result == SomeClip) {
 		return clip_result;
@@ -889,11 +946,11 @@ inline void quadsquare::MakeNoBlendTri(int a, int b, int c, int terrain) {
 }
 
 void quadsquare::RenderAux(const quadcornerdata& cd, clip_result_t vis, int terrain) {
-	int	half = 1 << cd.Level;
-	int	whole = 2 << cd.Level;
 	if (vis != NoClip) {
 		vis = ClipSquare(cd);
 		if (vis == NotVisible) return;
+	} else if (cd.xorg >= RowSize-1 || cd.zorg >= NumRows-1) {
+		return;
 	}
 
 	int	flags = 0;
@@ -910,6 +967,13 @@ void quadsquare::RenderAux(const quadcornerdata& cd, clip_result_t vis, int terr
 	}
 
 	if (flags == 0) return;
+	EmitTris(cd, flags, terrain);
+}
+
+// the triangles of the quadrants without enabled child
+void quadsquare::EmitTris(const quadcornerdata& cd, int flags, int terrain) {
+	int	half = 1 << cd.Level;
+	int	whole = 2 << cd.Level;
 
 	InitVert(0, cd.xorg + half, cd.zorg + half);
 	InitVert(1, cd.xorg + whole, cd.zorg + half);
@@ -922,7 +986,7 @@ void quadsquare::RenderAux(const quadcornerdata& cd, clip_result_t vis, int terr
 	InitVert(8, cd.xorg + whole, cd.zorg + whole);
 	if (terrain == -1) {
 		make_tri_list(MakeSpecialTri, EnabledFlags, flags, terrain);
-	} else if (param.perf_level > 1) {
+	} else if (BlendTerrains) {
 		make_tri_list(MakeTri, EnabledFlags, flags, terrain);
 	} else {
 		make_tri_list(MakeNoBlendTri, EnabledFlags, flags, terrain);
@@ -1073,11 +1137,401 @@ float HeightMapInfo::Sample(int x, int z) const {
 static quadsquare *root = (quadsquare*) nullptr;
 static quadcornerdata root_corner_data = {(quadcornerdata*)nullptr };
 
+// --------------------------------------------------------------------
+// 				retained-mode rendering
+// --------------------------------------------------------------------
+
+// The vertex array of the course is uploaded once into a static buffer
+// object. The blend weight of each terrain is precomputed per vertex, as
+// a one-component texture coordinate of the second texture unit, which
+// looks up the alpha in a ramp of two texels. The index lists are only
+// collected again when the quadtree mesh changed. They are grouped in
+// blocks of the tree, and each frame only the ranges of the blocks in the
+// view frustum are drawn.
+
+#define BLOCK_LEVEL 5	// squares of 64 vertices per side
+
+struct TIndexRange {
+	GLintptr first;		// offset of the indices in index_buffer
+	GLsizei count;
+};
+
+struct TQuadBlock {
+	TVector3d min;
+	TVector3d max;
+};
+
+struct TIndexLists {
+	std::vector<GLuint> indices;
+	std::vector<TQuadBlock> blocks;
+	// the ranges of each block, one list per terrain, the last one for the
+	// triangles with 3 different terrains, empty if the pass is not drawn
+	std::vector<std::vector<TIndexRange> > passes;
+	bool blend;
+	bool changed;
+};
+
+static GLuint vertex_buffer = 0;
+static GLuint weight_buffer = 0;
+static GLuint index_buffer = 0;
+static GLuint weight_ramp = 0;	// alpha texture, 0 and 255
+static std::vector<GLintptr> terrain_weights;	// offsets in weight_buffer
+static std::vector<GLintptr> special_weights;
+static TIndexLists index_lists[2];
+static TIndexLists* front_lists = &index_lists[0];	// drawn by the renderer
+static TIndexLists* back_lists = &index_lists[1];	// filled by the update
+
+static void ResetRetainedBuffers() {
+	if (vertex_buffer != 0) glDeleteBuffers_p(1, &vertex_buffer);
+	if (weight_buffer != 0) glDeleteBuffers_p(1, &weight_buffer);
+	if (index_buffer != 0) glDeleteBuffers_p(1, &index_buffer);
+	if (weight_ramp != 0) glDeleteTextures(1, &weight_ramp);
+	vertex_buffer = weight_buffer = index_buffer = weight_ramp = 0;
+	terrain_weights.clear();
+	special_weights.clear();
+	for (int i=0; i<2; i++) {
+		index_lists[i].blocks.clear();
+		index_lists[i].passes.clear();
+		index_lists[i].changed = false;
+	}
+}
+
+static void InitRetainedBuffers(int nx, int nz) {
+	if (!HaveBufferObjects() || !HaveMultitexture()) return;
+
+	const std::size_t numVerts = (std::size_t)nx * nz;
+	const std::size_t numTerrains = Course.TerrList.size();
+	const CourseFields* fields = &Course.Fields[0];
+
+	glGenBuffers_p(1, &vertex_buffer);
+	glBindBuffer_p(GL_ARRAY_BUFFER, vertex_buffer);
+	glBufferData_p(GL_ARRAY_BUFFER, STRIDE_GL_ARRAY * numVerts,
+	               Course.GetGLArrays(), GL_STATIC_DRAW);
+
+	// Two weight blocks for every terrain in use: the weight of the normal
+	// blending pass (covers all higher terrains) and the weight of the pass
+	// for the triangles with three different terrains (exact match).
+	terrain_weights.assign(numTerrains, 0);
+	special_weights.assign(numTerrains, 0);
+	std::vector<GLshort> weights;
+	for (std::size_t j=0; j<numTerrains; j++) {
+		if (Course.TerrList[j].texture == nullptr) continue;
+
+		terrain_weights[j] = weights.size() * sizeof(GLshort);
+		for (std::size_t i=0; i<numVerts; i++)
+			weights.push_back(j <= fields[i].terrain ? 1 : 0);
+
+		special_weights[j] = weights.size() * sizeof(GLshort);
+		for (std::size_t i=0; i<numVerts; i++)
+			weights.push_back(j == fields[i].terrain ? 1 : 0);
+	}
+
+	glGenBuffers_p(1, &weight_buffer);
+	glBindBuffer_p(GL_ARRAY_BUFFER, weight_buffer);
+	glBufferData_p(GL_ARRAY_BUFFER, weights.size() * sizeof(GLshort),
+	               weights.empty() ? nullptr : &weights[0], GL_STATIC_DRAW);
+	glBindBuffer_p(GL_ARRAY_BUFFER, 0);
+
+	// interpolated weights between 0 and 1 map linearly to the alpha,
+	// the texture matrix moves them to the texel centres
+	static const GLubyte ramp[2] = { 0, 255 };
+	glGenTextures(1, &weight_ramp);
+	glBindTexture(GL_TEXTURE_1D, weight_ramp);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage1D(GL_TEXTURE_1D, 0, GL_ALPHA, 2, 0, GL_ALPHA, GL_UNSIGNED_BYTE, ramp);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_1D, 0);
+
+	glGenBuffers_p(1, &index_buffer);
+	quadsquare::MeshChanged = true;
+}
+
+// state of the collection, used by EndBlock
+static TIndexLists* collect_lists = nullptr;
+static std::vector<TIndexRange>* collect_ranges = nullptr;
+static std::size_t block_start = 0;	// in VertexArrayIndices
+
+static void EndBlock(const quadcornerdata& cd, float miny, float maxy) {
+	TIndexRange range;
+	range.first = (collect_lists->indices.size() + block_start) * sizeof(GLuint);
+	range.count = quadsquare::VertexArrayCounter - block_start;
+	collect_ranges->push_back(range);
+	block_start = quadsquare::VertexArrayCounter;
+
+	// the blocks are the same in each pass
+	if (collect_ranges->size() <= collect_lists->blocks.size()) return;
+	int whole = 2 << cd.Level;
+	TQuadBlock block;
+	block.min = TVector3d(cd.xorg * quadsquare::ScaleX, miny, cd.zorg * quadsquare::ScaleZ);
+	block.max = TVector3d((cd.xorg + whole) * quadsquare::ScaleX, maxy, (cd.zorg + whole) * quadsquare::ScaleZ);
+	if (block.min.x > block.max.x) std::swap(block.min.x, block.max.x);
+	if (block.min.z > block.max.z) std::swap(block.min.z, block.max.z);
+	collect_lists->blocks.push_back(block);
+}
+
+static void CollectPass(TIndexLists* lists, std::vector<TIndexRange>* ranges, int terrain) {
+	collect_lists = lists;
+	collect_ranges = ranges;
+	block_start = 0;
+	quadsquare::InitArrayCounters();
+	root->CollectBlocks(root_corner_data, terrain, BLOCK_LEVEL, EndBlock);
+	lists->indices.insert(lists->indices.end(), quadsquare::VertexArrayIndices,
+	                      quadsquare::VertexArrayIndices + quadsquare::VertexArrayCounter);
+}
+
+// Traverses the tree only, so it can run on the update thread as well.
+static void CollectIndexLists(TIndexLists* lists, bool blend) {
+	lists->changed = quadsquare::MeshChanged || lists->blend != blend ||
+	                 lists->passes.empty();
+	if (!lists->changed) return;
+
+	lists->indices.clear();
+	lists->blocks.clear();
+	lists->blend = blend;
+	quadsquare::BlendTerrains = blend;
+
+	std::size_t numTerrains = Course.TerrList.size();
+	lists->passes.assign(numTerrains + 1, std::vector<TIndexRange>());
+	for (std::size_t j=0; j<numTerrains; j++) {
+		if (Course.TerrList[j].texture == nullptr) continue;
+		CollectPass(lists, &lists->passes[j], (int)j);
+	}
+	if (blend)
+		CollectPass(lists, &lists->passes[numTerrains], -1);
+	quadsquare::MeshChanged = false;
+}
+
+static void UploadIndexLists(TIndexLists* lists) {
+	if (!lists->changed) return;
+
+	glBindBuffer_p(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+	glBufferData_p(GL_ELEMENT_ARRAY_BUFFER, lists->indices.size() * sizeof(GLuint),
+	               lists->indices.empty() ? nullptr : &lists->indices[0], GL_DYNAMIC_DRAW);
+	glBindBuffer_p(GL_ELEMENT_ARRAY_BUFFER, 0);
+	lists->changed = false;
+}
+
+static std::vector<char> block_visible;
+static std::vector<TIndexRange> draw_ranges;
+
+// The ranges of the visible blocks of a pass, neighbouring ranges are
+// merged to one draw call.
+static void CollectDrawRanges(const std::vector<TIndexRange>& ranges) {
+	draw_ranges.clear();
+	for (std::size_t b=0; b<ranges.size(); b++) {
+		if (!block_visible[b] || ranges[b].count == 0) continue;
+		if (!draw_ranges.empty() && draw_ranges.back().first +
+		        (GLintptr)(draw_ranges.back().count * sizeof(GLuint)) == ranges[b].first)
+			draw_ranges.back().count += ranges[b].count;
+		else
+			draw_ranges.push_back(ranges[b]);
+	}
+}
+
+static void DrawRanges() {
+	for (std::size_t r=0; r<draw_ranges.size(); r++) {
+		glDrawElements(GL_TRIANGLES, draw_ranges[r].count, GL_UNSIGNED_INT,
+		               (const GLvoid*)draw_ranges[r].first);
+		rendered_triangles += draw_ranges[r].count / 3;
+		num_draw_calls++;
+	}
+}
+
+static void DrawRetainedPass(GLintptr weights) {
+	glTexCoordPointer(1, GL_SHORT, 0, (const GLvoid*)weights);
+	DrawRanges();
+}
+
+static void RenderRetained(const TIndexLists& lists) {
+	if (lists.passes.empty()) return;
+
+	// culled each frame against the current view
+	const TViewFrustum& frustum = GetViewFrustum();
+	block_visible.resize(lists.blocks.size());
+	for (std::size_t b=0; b<lists.blocks.size(); b++)
+		block_visible[b] = frustum.Clip(lists.blocks[b].min, lists.blocks[b].max) != NotVisible;
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glBindBuffer_p(GL_ARRAY_BUFFER, vertex_buffer);
+	glBindBuffer_p(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+	glVertexPointer(3, GL_FLOAT, STRIDE_GL_ARRAY, (const GLvoid*)0);
+	glNormalPointer(GL_FLOAT, STRIDE_GL_ARRAY, (const GLvoid*)(4 * sizeof(GLfloat)));
+	glColor4ub(255, 255, 255, 255);
+
+	// the weights on the second texture unit
+	glActiveTexture_p(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_1D, weight_ramp);
+	glEnable(GL_TEXTURE_1D);
+	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	glMatrixMode(GL_TEXTURE);
+	glLoadIdentity();
+	glTranslatef(0.25f, 0.f, 0.f);
+	glScalef(0.5f, 1.f, 1.f);
+	glMatrixMode(GL_MODELVIEW);
+	glActiveTexture_p(GL_TEXTURE0);
+	glClientActiveTexture_p(GL_TEXTURE1);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glBindBuffer_p(GL_ARRAY_BUFFER, weight_buffer);
+
+	std::size_t numTerrains = lists.passes.size() - 1;
+	for (std::size_t j=0; j<numTerrains; j++) {
+		if (lists.passes[j].empty()) continue;
+		CollectDrawRanges(lists.passes[j]);
+		if (draw_ranges.empty()) continue;
+		Course.TerrList[j].texture->Bind();
+		DrawRetainedPass(terrain_weights[j]);
+	}
+
+	CollectDrawRanges(lists.passes[numTerrains]);
+	if (!draw_ranges.empty()) {
+		glDisable(GL_FOG);
+		glActiveTexture_p(GL_TEXTURE1);
+		glDisable(GL_TEXTURE_1D);
+		glActiveTexture_p(GL_TEXTURE0);
+		glColor4ub(0, 0, 0, 255);
+		Course.TerrList[0].texture->Bind();
+		DrawRanges();
+		glColor4ub(255, 255, 255, 255);
+		glActiveTexture_p(GL_TEXTURE1);
+		glEnable(GL_TEXTURE_1D);
+		glActiveTexture_p(GL_TEXTURE0);
+		glEnable(GL_FOG);
+
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+		for (std::size_t j=0; j<numTerrains; j++) {
+			if (Course.TerrList[j].texture == nullptr) continue;
+			Course.TerrList[j].texture->Bind();
+			DrawRetainedPass(special_weights[j]);
+		}
+	}
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glClientActiveTexture_p(GL_TEXTURE0);
+	glActiveTexture_p(GL_TEXTURE1);
+	glDisable(GL_TEXTURE_1D);
+	glBindTexture(GL_TEXTURE_1D, 0);
+	glMatrixMode(GL_TEXTURE);
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
+	glActiveTexture_p(GL_TEXTURE0);
+
+	glBindBuffer_p(GL_ARRAY_BUFFER, 0);
+	glBindBuffer_p(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+}
+
+// --------------------------------------------------------------------
+// 				update thread
+// --------------------------------------------------------------------
+
+// With param.threaded_quadtree the LOD update for the next frame runs on
+// a worker thread while the current frame is drawn. The worker owns the
+// tree during an update and fills the back index lists; the renderer
+// only draws the front lists, which are swapped when the worker is idle.
+// The drawn mesh therefore lags at least one frame behind the view, more
+// while the worker is busy. Its lists are not clipped, the renderer culls
+// the blocks against the current frustum, so a turn shows no holes, only
+// the detail of the newly visible squares follows a frame later.
+
+struct TQuadtreeJob {
+	TVector3d view_pos;
+	float detail;
+	bool blend;
+	TViewFrustum frustum;
+};
+
+class CQuadtreeWorker {
+private:
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable cond;
+	TQuadtreeJob job;
+	bool pending;
+	bool busy;
+	bool quit;
+
+	void Run();
+public:
+	CQuadtreeWorker() : pending(false), busy(false), quit(false) {}
+	~CQuadtreeWorker();
+
+	void Start(const TQuadtreeJob& next);
+	bool Idle();
+	void Wait();
+};
+
+static CQuadtreeWorker Worker;
+
+CQuadtreeWorker::~CQuadtreeWorker() {
+	if (thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		cond.notify_all();
+		thread.join();
+	}
+}
+
+void CQuadtreeWorker::Run() {
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		cond.wait(lock, [this] { return pending || quit; });
+		if (quit) return;
+		pending = false;
+		TQuadtreeJob current = job;
+		lock.unlock();
+
+		root->Update(root_corner_data, current.view_pos, current.detail, current.frustum);
+		CollectIndexLists(back_lists, current.blend);
+
+		lock.lock();
+		busy = false;
+		cond.notify_all();
+	}
+}
+
+void CQuadtreeWorker::Start(const TQuadtreeJob& next) {
+	if (!thread.joinable())
+		thread = std::thread(&CQuadtreeWorker::Run, this);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	job = next;
+	pending = true;
+	busy = true;
+	cond.notify_all();
+}
+
+bool CQuadtreeWorker::Idle() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return !busy;
+}
+
+void CQuadtreeWorker::Wait() {
+	std::unique_lock<std::mutex> lock(mutex);
+	cond.wait(lock, [this] { return !busy; });
+}
+
+static bool UseUpdateThread() {
+	return param.threaded_quadtree && vertex_buffer != 0;
+}
+
+// --------------------------------------------------------------------
+
 void ResetQuadtree() {
+	Worker.Wait();
 	if (root != nullptr) {
 		delete root;
 		root = (quadsquare*) nullptr;
 	}
+	Telemetry.Set(CNT_QUADTREE_NODES, 0);
+	ResetRetainedBuffers();
 }
 
 static int get_root_level(int nx, int nz) {
@@ -1116,15 +1570,58 @@ void InitQuadtree(CourseFields* fields, int nx, int nz,
 	root->StaticCullData(root_corner_data, CULL_DETAIL_FACTOR);
 
 	for (int i = 0; i < 10; i++) {
-		root->Update(root_corner_data, view_pos, detail);
+		root->Update(root_corner_data, view_pos, detail, GetViewFrustum());
 	}
+
+	InitRetainedBuffers(nx, nz);
+	if (vertex_buffer != 0) {
+		CollectIndexLists(front_lists, param.perf_level > 1);
+		UploadIndexLists(front_lists);
+	}
+}
+
+// Brings the lists of the last threaded update to the front. The back
+// lists are left as they are if the mesh didn't change in the meantime.
+static void SwapIndexLists() {
+	if (!back_lists->changed) return;
+	std::swap(front_lists, back_lists);
+	UploadIndexLists(front_lists);
 }
 
 void UpdateQuadtree(const TVector3d& view_pos, float detail) {
-	root->Update(root_corner_data, view_pos, detail);
+	bool blend = param.perf_level > 1;
+	if (!UseUpdateThread()) {
+		Worker.Wait();
+		SwapIndexLists();
+		root->Update(root_corner_data, view_pos, detail, GetViewFrustum());
+		if (vertex_buffer != 0) {
+			CollectIndexLists(front_lists, blend);
+			UploadIndexLists(front_lists);
+		}
+		return;
+	}
+
+	// If the worker hasn't finished the last update yet, the previous mesh
+	// is drawn once more instead of stalling the frame. The mesh drawn in
+	// this frame is the one of the last frame's view.
+	if (!Worker.Idle()) return;
+	SwapIndexLists();
+
+	TQuadtreeJob job;
+	job.view_pos = view_pos;
+	job.detail = detail;
+	job.blend = blend;
+	job.frustum = GetViewFrustum();
+	Worker.Start(job);
 }
 
-void RenderQuadtree() {
+std::size_t RenderQuadtree() {
+	rendered_triangles = 0;
+	if (vertex_buffer != 0) {
+		RenderRetained(*front_lists);
+		return rendered_triangles;
+	}
+
 	GLubyte *vnc_array = Course.GetGLArrays();
 
 	glEnableClientState(GL_VERTEX_ARRAY);
@@ -1143,4 +1640,5 @@ void RenderQuadtree() {
 	glDisableClientState(GL_VERTEX_ARRAY);
 	glDisableClientState(GL_NORMAL_ARRAY);
 	glDisableClientState(GL_COLOR_ARRAY);
+	return rendered_triangles;
 }
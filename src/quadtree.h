@@ -45,6 +45,10 @@ struct HeightMapInfo {
 
 struct	VertInfo { float Y; };
 struct quadsquare;
+class quadcornerdata;
+
+// called by CollectBlocks after the triangles of a block were collected
+typedef void (*block_func_t)(const quadcornerdata& cd, float miny, float maxy);
 
 class quadcornerdata {
 public:
@@ -79,6 +83,14 @@ struct quadsquare {
 	static GLuint VertexArrayMinIdx;
 	static GLuint VertexArrayMaxIdx;
 
+	// set whenever the enabled vertices change, so that retained index
+	// buffers only have to be rebuilt if the mesh was really modified
+	static bool MeshChanged;
+	// state of the current Update or Render call, kept here so that the
+	// update can run on another thread than the renderer
+	static bool BlendTerrains;
+	static TViewFrustum Frustum;
+
 	static void MakeTri(int a, int b, int c, int terrain);
 	static void MakeSpecialTri(int a, int b, int c, int terrain);
 	static void MakeNoBlendTri(int a, int b, int c, int terrain);
@@ -93,8 +105,11 @@ struct quadsquare {
 	void	StaticCullData(const quadcornerdata& cd, float ThresholdDetail);
 	float	RecomputeError(const quadcornerdata& cd);
 	int		CountNodes();
-	void	Update(const quadcornerdata& cd, const TVector3d& ViewerLocation, float Detail);
+	void	Update(const quadcornerdata& cd, const TVector3d& ViewerLocation,
+	              float Detail, const TViewFrustum& frustum);
 	void	Render(const quadcornerdata& cd, GLubyte *vnc_array);
+	void	CollectBlocks(const quadcornerdata& cd, int terrain, int block_level,
+	                      block_func_t block_done);
 	float	GetHeight(const quadcornerdata& cd, float x, float z);
 	void	SetScale(double x, double z);
 	void	SetFields(CourseFields* fields);
@@ -119,6 +134,7 @@ private:
 	                  float CenterError, clip_result_t vis);
 	void	RenderAux(const quadcornerdata &cd, clip_result_t vis,
 	                  int terrain);
+	void	EmitTris(const quadcornerdata &cd, int flags, int terrain);
 	void	SetStatic(const quadcornerdata &cd);
 	void	InitVert(int i, int x, int z);
 	bool	VertexTest(int x, float y, int z, float error, const float Viewer[3],
@@ -137,7 +153,7 @@ void InitQuadtree(CourseFields* fields, int nx, int nz,
                   const TVector3d& view_pos, double detail);
 
 void UpdateQuadtree(const TVector3d& view_pos, float detail);
-void RenderQuadtree();
+std::size_t RenderQuadtree();	// returns the number of triangles
 
 
 #endif
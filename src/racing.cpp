@@ -37,6 +37,14 @@ GNU General Public License for more details.
 #include "winsys.h"
 #include "physics.h"
 #include "tux.h"
+#include "render_queue.h"
+#include "effect_budget.h"
+#include "frame_pacer.h"
+#include "profiler.h"
+#include "sim_thread.h"
+#include "input.h"
+#include "replay.h"
+#include "ghost.h"
 #include <algorithm>
 
 #define MAX_JUMP_AMT 1.0
@@ -45,6 +53,19 @@ GNU General Public License for more details.
 
 CRacing Racing;
 
+// The steering controls are queued as input events and applied by the
+// steps, the flags below belong to the thread running the steps.
+enum TRaceInput {
+	INPUT_LEFT,
+	INPUT_RIGHT,
+	INPUT_PADDLE,
+	INPUT_BRAKE,
+	INPUT_CHARGE,
+	INPUT_TRICK,
+	INPUT_STICK_X,
+	INPUT_STICK_Y
+};
+
 static bool right_turn;
 static bool left_turn;
 static bool stick_turn;
@@ -66,26 +87,39 @@ static bool trees = true;
 static int newsound = -1;
 static int lastsound = -1;
 
+// the values the hud shows, the physics thread owns g_game while it runs
+static float hud_time;
+static int hud_herring;
+static bool hud_finish;
+
+// the input shown by the frame, for the latency measure
+static float input_time;
+
+// a replay brings its own input
+static void PushInput(int action, float value) {
+	if (!Replay.Playing()) Input.Push(action, value);
+}
+
 void CRacing::Keyb(sf::Keyboard::Key key, bool release, int x, int y) {
 	switch (key) {
 		// steering flipflops
 		case sf::Keyboard::Up:
-			key_paddling = !release;
+			PushInput(INPUT_PADDLE, !release);
 			break;
 		case sf::Keyboard::Down:
-			key_braking = !release;
+			PushInput(INPUT_BRAKE, !release);
 			break;
 		case sf::Keyboard::Left:
-			left_turn = !release;
+			PushInput(INPUT_LEFT, !release);
 			break;
 		case sf::Keyboard::Right:
-			right_turn = !release;
+			PushInput(INPUT_RIGHT, !release);
 			break;
 		case sf::Keyboard::Space:
-			key_charging = !release;
+			PushInput(INPUT_CHARGE, !release);
 			break;
 		case sf::Keyboard::T:
-			trick_modifier = !release;
+			PushInput(INPUT_TRICK, !release);
 			break;
 
 		// mode changing and other actions
@@ -100,7 +134,7 @@ void CRacing::Keyb(sf::Keyboard::Key key, bool release, int x, int y) {
 			if (!release) State::manager.RequestEnterState(Paused);
 			break;
 		case sf::Keyboard::R:
-			if (!release) State::manager.RequestEnterState(Reset);
+			if (!release && !Replay.Playing()) State::manager.RequestEnterState(Reset);
 			break;
 		case sf::Keyboard::S:
 			if (!release) Winsys.TakeScreenshot();
@@ -145,42 +179,125 @@ void CRacing::Keyb(sf::Keyboard::Key key, bool release, int x, int y) {
 		case sf::Keyboard::F8:
 			if (!release) trees = !trees;
 			break;
+		case sf::Keyboard::F9:
+			if (!release) Profiler.ToggleOverlay();
+			break;
+		case sf::Keyboard::F10:
+			if (!release) Profiler.ToggleLog();
+			break;
 		default:
 			break;
 	}
 }
 
 void CRacing::Jaxis(int axis, float value) {
-	if (axis == 0) { 	// left and right
-		stick_turn = ((value < -0.2) || (value > 0.2));
-		if (stick_turn) stick_turnfact = value;
-		else stick_turnfact = 0.0;
-	} else if (axis == 1) {	// paddling and braking
-		stick_paddling = (value < -0.3);
-		stick_braking = (value > 0.3);
-	}
+	if (axis == 0) PushInput(INPUT_STICK_X, value);
+	else if (axis == 1) PushInput(INPUT_STICK_Y, value);
 }
 
 void CRacing::Jbutt(int button, bool pressed) {
 	switch (button) {
 		case 0:
-			key_paddling = pressed;
+			PushInput(INPUT_PADDLE, pressed);
 			break;
 		case 1:
-			trick_modifier = pressed;
+			PushInput(INPUT_TRICK, pressed);
 			break;
 		case 2:
-			key_braking = pressed;
+			PushInput(INPUT_BRAKE, pressed);
 			break;
 		case 3:
-			key_charging = pressed;
+			PushInput(INPUT_CHARGE, pressed);
 			break;
 	}
 }
 
-static void CalcJumpEnergy(float time_step) {
-	CControl *ctrl = g_game.player->ctrl;
+// Applies the input events read before the end of the step.
+static void ApplyInput(float step_time) {
+	TInputEvent event;
+	while (Input.Pop(step_time, event)) {
+		bool on = event.value != 0.f;
+		switch (event.action) {
+			case INPUT_LEFT:
+				left_turn = on;
+				break;
+			case INPUT_RIGHT:
+				right_turn = on;
+				break;
+			case INPUT_PADDLE:
+				key_paddling = on;
+				break;
+			case INPUT_BRAKE:
+				key_braking = on;
+				break;
+			case INPUT_CHARGE:
+				key_charging = on;
+				break;
+			case INPUT_TRICK:
+				trick_modifier = on;
+				break;
+			case INPUT_STICK_X:	// left and right
+				stick_turn = ((event.value < -0.2) || (event.value > 0.2));
+				if (stick_turn) stick_turnfact = event.value;
+				else stick_turnfact = 0.0;
+				break;
+			case INPUT_STICK_Y:	// paddling and braking
+				stick_paddling = (event.value < -0.3);
+				stick_braking = (event.value > 0.3);
+				break;
+		}
+	}
+}
+
+static TReplayInput GetReplayInput() {
+	TReplayInput input;
+	input.flags = (left_turn ? REPLAY_LEFT : 0) | (right_turn ? REPLAY_RIGHT : 0)
+	              | (stick_turn ? REPLAY_STICK_TURN : 0)
+	              | (key_paddling ? REPLAY_KEY_PADDLE : 0) | (stick_paddling ? REPLAY_STICK_PADDLE : 0)
+	              | (key_braking ? REPLAY_KEY_BRAKE : 0) | (stick_braking ? REPLAY_STICK_BRAKE : 0)
+	              | (key_charging ? REPLAY_KEY_CHARGE : 0) | (stick_charging ? REPLAY_STICK_CHARGE : 0)
+	              | (trick_modifier ? REPLAY_TRICK : 0);
+	input.turnfact = stick_turnfact;
+	return input;
+}
+
+static void SetReplayInput(const TReplayInput& input) {
+	left_turn = (input.flags & REPLAY_LEFT) != 0;
+	right_turn = (input.flags & REPLAY_RIGHT) != 0;
+	stick_turn = (input.flags & REPLAY_STICK_TURN) != 0;
+	key_paddling = (input.flags & REPLAY_KEY_PADDLE) != 0;
+	stick_paddling = (input.flags & REPLAY_STICK_PADDLE) != 0;
+	key_braking = (input.flags & REPLAY_KEY_BRAKE) != 0;
+	stick_braking = (input.flags & REPLAY_STICK_BRAKE) != 0;
+	key_charging = (input.flags & REPLAY_KEY_CHARGE) != 0;
+	stick_charging = (input.flags & REPLAY_STICK_CHARGE) != 0;
+	trick_modifier = (input.flags & REPLAY_TRICK) != 0;
+	stick_turnfact = input.turnfact;
+}
+
+// The input of a step comes from the queued events or from the replay,
+// false at the end of the replay.
+static bool StepInput(CControl *ctrl, float step_time) {
+	if (!Replay.Playing()) {
+		ApplyInput(step_time);
+		if (Replay.Recording()) Replay.Record(GetReplayInput());
+		return true;
+	}
 
+	double x, z, time;
+	if (Replay.TakeReset(x, z, time)) {
+		ctrl->cpos.x = x;
+		ctrl->cpos.z = z;
+		ctrl->Init();
+		g_game.time = time;
+	}
+	TReplayInput input;
+	if (!Replay.Next(input)) return false;
+	SetReplayInput(input);
+	return true;
+}
+
+static void CalcJumpEnergy(CControl *ctrl, float time_step) {
 	if (ctrl->jump_charging) {
 		ctrl->jump_amt = std::min(MAX_JUMP_AMT, g_game.time - charge_start_time);
 	} else if (ctrl->jumping) {
@@ -229,11 +346,35 @@ void CRacing::Enter() {
 	stick_paddling = false;
 	stick_braking = false;
 	stick_turn = false;
+	Input.Clear();
+	input_time = -1.f;
 
 	lastsound = -1;
 	newsound = -1;
 
-	if (State::manager.PreviousState() != &Paused) ctrl->Init();
+	State *previous = State::manager.PreviousState();
+	if (previous != &Paused) {
+		if (Replay.Playing() && previous != &Reset) {
+			Replay.Rewind();
+			ctrl->cpos.x = Replay.start_x;
+			ctrl->cpos.z = Replay.start_z;
+			g_game.time = Replay.start_time;
+		}
+		ctrl->Init();
+		EffectBudget.Reset();
+		Profiler.Reset();
+		if (previous == &Reset) {
+			if (Replay.Recording()) Replay.RecordReset(ctrl);
+		} else {
+			// the intro has moved the wind with the frame time, the race
+			// starts from a fresh wind that a replay can repeat
+			if (Replay.Playing()) Wind.Init(g_game.wind_id, Replay.wind_seed);
+			else InitWind();
+			Ghost.StartRace(Course.currentCourseList->name, g_game.course->dir);
+			if (param.record_races && !Replay.Playing())
+				Replay.StartRecording(ctrl);
+		}
+	}
 	g_game.raceaborted = false;
 
 	SetSoundVolumes();
@@ -242,6 +383,11 @@ void CRacing::Enter() {
 	g_game.finish = false;
 
 	Winsys.KeyRepeat(false);
+	hud_time = g_game.time;
+	hud_herring = g_game.herring;
+	hud_finish = false;
+	if (param.threaded_physics && !SimThread.Start(ctrl, SimulateRaceStep))
+		Message("running the physics on the main thread");
 }
 
 // -------------------- sound -----------------------------------------
@@ -306,7 +452,7 @@ static void CalcSteeringControls(CControl *ctrl, float time_step) {
 
 	bool charge = key_charging || stick_charging;
 	bool invcharge = !key_charging && !stick_charging;
-	CalcJumpEnergy(time_step);
+	CalcJumpEnergy(ctrl, time_step);
 	if ((charge) && !ctrl->jump_charging && !ctrl->jumping) {
 		ctrl->jump_charging = true;
 		charge_start_time = g_game.time;
@@ -364,50 +510,188 @@ static void CalcTrickControls(CControl *ctrl, float time_step, bool airborne) {
 //					loop
 // ====================================================================
 
-void CRacing::Loop(float time_step) {
-	CControl *ctrl = g_game.player->ctrl;
+// The profiler frame begins with the first simulation step of the frame,
+// or with the drawing if no step is due.
+static bool profiler_frame = false;
+
+static void BeginProfilerFrame() {
+	if (profiler_frame) return;
+	Profiler.BeginFrame();
+	profiler_frame = true;
+}
+
+// One step of the simulation, on the physics thread if it runs. The
+// wind, the track marks and the particles are left to the caller.
+void SimulateRaceStep(CControl *ctrl, float timestep, float step_time) {
+	if (!StepInput(ctrl, step_time)) {
+		// the recording of an aborted race ends before the finish
+		if (!g_game.finish) g_game.raceaborted = true;
+		ctrl->game_over = true;
+		return;
+	}
 	double ycoord = Course.FindYCoord(ctrl->cpos.x, ctrl->cpos.z);
 	bool airborne = (bool)(ctrl->cpos.y > (ycoord + JUMP_MAX_START_HEIGHT));
 
-	ClearRenderContext();
-	Env.SetupFog();
-	CalcTrickControls(ctrl, time_step, airborne);
+	ctrl->BeginStep();
+	CalcTrickControls(ctrl, timestep, airborne);
 
-	if (!g_game.finish) CalcSteeringControls(ctrl, time_step);
-	else CalcFinishControls(ctrl, time_step, airborne);
+	if (!g_game.finish) CalcSteeringControls(ctrl, timestep);
+	else CalcFinishControls(ctrl, timestep, airborne);
 	PlayTerrainSound(ctrl, airborne);
 
 //  >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-	ctrl->UpdatePlayerPos(time_step);
+	ctrl->UpdatePlayerPos(timestep);
 //  >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 
-	if (g_game.finish) IncCameraDistance(time_step);
-	update_view(ctrl, time_step);
-	UpdateTrackmarks(ctrl);
-
-	SetupViewFrustum(ctrl);
-	if (sky) Env.DrawSkybox(ctrl->viewpos);
-	if (fog) Env.DrawFog();
-	Env.SetupLight();
-	if (terr) RenderCourse();
-	DrawTrackmarks();
-	if (trees) DrawTrees();
-	if (param.perf_level > 2) {
+	if (g_game.finish == false) g_game.time += timestep;
+	Ghost.Record(ctrl, g_game.time);
+}
+
+// one step of the simulation, called by the state manager with SIM_TIMESTEP
+void CRacing::Update(float timestep) {
+	if (SimThread.Active()) return;
+
+	CControl *ctrl = g_game.player->ctrl;
+	BeginProfilerFrame();
+	{
+		CProfiler::Scope prof(PROF_PHYSICS, false);
+		UpdateWind(timestep);
+		SimulateRaceStep(ctrl, timestep, State::manager.StepTime());
+	}
+	if (ctrl->game_over) State::manager.RequestEnterState(GameOver);
+	{
+		CProfiler::Scope prof(PROF_PARTICLES, false);
+		emit_queued_particles(ctrl);
+	}
+	{
+		CProfiler::Scope prof(PROF_TRACKS, false);
+		UpdateTrackmarks(ctrl);
+	}
+}
+
+// Takes the newest snapshot of the physics thread into the player, the
+// shape, the wind and the items, and applies its events.
+static void TakeSimSnapshot(CControl *ctrl) {
+	const TSimSnapshot *snap = SimThread.Take();
+	if (snap == nullptr) return;
+
+	ctrl->CopySimState(snap->ctrl);
+	g_game.character->shape->SetTransforms(snap->joints, snap->inv_joints);
+	Wind = snap->wind;
+	for (std::size_t i = 0; i < snap->collected.size(); i++)
+		Course.NocollArr[snap->collected[i]].collectable = 0;
+	hud_time = snap->time;
+	hud_herring = snap->herring;
+	hud_finish = snap->finish;
+	input_time = snap->input_time;
+	{
+		CProfiler::Scope prof(PROF_PARTICLES, false);
+		emit_particles(ctrl, snap->emissions);
+	}
+	{
+		CProfiler::Scope prof(PROF_TRACKS, false);
+		UpdateTrackmarks(ctrl);
+	}
+	if (snap->ctrl.game_over) State::manager.RequestEnterState(GameOver);
+}
+
+void CRacing::Loop(float time_step) {
+	CControl *ctrl = g_game.player->ctrl;
+	BeginProfilerFrame();
+
+	float alpha;
+	if (SimThread.Active()) {
+		TakeSimSnapshot(ctrl);
+		alpha = SimThread.Alpha();
+	} else {
+		hud_time = g_game.time;
+		hud_herring = g_game.herring;
+		hud_finish = g_game.finish;
+		input_time = Input.TakeApplied();
+		alpha = State::manager.SimAlpha();
+	}
+
+	ClearRenderContext();
+	Env.SetupFog();
+	{
+		CProfiler::Scope prof(PROF_VIEW, false);
+		ctrl->Interpolate(alpha);
+		if (hud_finish) IncCameraDistance(time_step);
+		update_view(ctrl, time_step);
+	}
+
+	// the snow and particle updates run as jobs while the course is drawn
+	{
+		CProfiler::Scope prof(PROF_SNOW, false);
+		UpdateSnow(time_step, ctrl);
+	}
+	{
+		CProfiler::Scope prof(PROF_PARTICLES, false);
 		update_particles(time_step);
+	}
+
+	{
+		CProfiler::Scope prof(PROF_COURSE);
+		SetupViewFrustum(ctrl);
+		if (sky) Env.DrawSkybox(ctrl->viewpos);
+		if (fog) Env.DrawFog();
+		Env.SetupLight();
+		if (terr) RenderCourse();
+	}
+	{
+		CProfiler::Scope prof(PROF_TRACKS);
+		DrawTrackmarks();
+	}
+	{
+		CProfiler::Scope prof(PROF_TREES);
+		if (trees) DrawTrees();
+		RenderQueue.Flush();
+	}
+	{
+		CProfiler::Scope prof(PROF_PARTICLES);
 		draw_particles(ctrl);
 	}
-	g_game.character->shape->Draw();
-	UpdateWind(time_step);
-	UpdateSnow(time_step, ctrl);
-	DrawSnow(ctrl);
-	DrawHud(ctrl);
+	{
+		CProfiler::Scope prof(PROF_TUX);
+		g_game.character->shape->Draw();
+		Ghost.Draw(hud_time, g_game.character->shape);
+	}
+	{
+		CProfiler::Scope prof(PROF_SNOW);
+		DrawSnow(ctrl);
+		RenderQueue.Flush();
+	}
+	{
+		CProfiler::Scope prof(PROF_HUD);
+		DrawHud(ctrl, hud_time, hud_herring);
+		Profiler.DrawOverlay();
+	}
 
-	Reshape(Winsys.resolution.width, Winsys.resolution.height);
-	Winsys.SwapBuffers();
-	if (g_game.finish == false) g_game.time += time_step;
+	{
+		CProfiler::Scope prof(PROF_SWAP);
+		Reshape(Winsys.resolution.width, Winsys.resolution.height);
+		Winsys.SwapBuffers();
+	}
+	if (input_time >= 0.f) {
+		Profiler.Latency((Input.Now() - input_time) * 1000.f);
+		input_time = -1.f;
+	}
+	// the budget is measured without the wait for the next frame
+	EffectBudget.EndFrame(time_step, std::max(0.f, time_step - FramePacer.LastWait()));
+	Profiler.EndFrame(time_step);
+	profiler_frame = false;
 }
 
 void CRacing::Exit() {
+	CControl *ctrl = g_game.player->ctrl;
+	SimThread.Stop(ctrl);
+	State *next = State::manager.NextState();
+	if (next != &Paused && next != &Reset) {
+		if (Replay.Recording()) Replay.StopRecording(ctrl);
+		Replay.Stop();
+	}
+	// the following states see the shape and the view at the last step
+	ctrl->Interpolate(1.0);
 	Winsys.KeyRepeat(true);
 	Sound.HaltAll();
 	break_track_marks();
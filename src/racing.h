@@ -23,6 +23,7 @@ GNU General Public License for more details.
 
 class CRacing : public State {
 	void Enter();
+	void Update(float timestep);
 	void Loop(float time_step);
 	void Keyb(sf::Keyboard::Key key, bool release, int x, int y);
 	void Jaxis(int axis, float value);
@@ -33,4 +34,7 @@ public:
 
 extern CRacing Racing;
 
+// one fixed step of the race, with the input of the step
+void SimulateRaceStep(CControl *ctrl, float timestep, float step_time);
+
 #endif
@@ -0,0 +1,183 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "render_queue.h"
+#include "textures.h"
+#include <algorithm>
+#include <cstddef>
+
+CRenderQueue RenderQueue;
+
+// Modes that write the depth of every drawn pixel, so the order of the
+// commands doesn't change the result. The others are blended and keep
+// the order of submission.
+static bool SortByTexture(TRenderMode mode) {
+	return mode == COURSE || mode == TREES || mode == TUX;
+}
+
+CRenderQueue::CRenderQueue()
+	: quad_vertices(0), draw_calls(0), buffer(0), buffer_size(0) {
+	current.nx = current.ny = 0.f;
+	current.nz = 1.f;
+	current.col[0] = current.col[1] = current.col[2] = current.col[3] = 255;
+}
+
+void CRenderQueue::Begin(TRenderMode mode, TTexture* texture) {
+	quad_vertices = 0;
+
+	// consecutive submissions with the same state share one command
+	if (!commands.empty() && commands.back().mode == mode && commands.back().texture == texture)
+		return;
+
+	TRenderCommand cmd;
+	cmd.mode = mode;
+	cmd.texture = texture;
+	cmd.first = vertices.size();
+	cmd.count = 0;
+	commands.push_back(cmd);
+}
+
+void CRenderQueue::Normal(const TVector3d& nml) {
+	current.nx = nml.x;
+	current.ny = nml.y;
+	current.nz = nml.z;
+}
+
+void CRenderQueue::Color(const sf::Color& col) {
+	current.col[0] = col.r;
+	current.col[1] = col.g;
+	current.col[2] = col.b;
+	current.col[3] = col.a;
+}
+
+void CRenderQueue::Vertex(const TVector3d& pt, float u, float v) {
+	current.x = pt.x;
+	current.y = pt.y;
+	current.z = pt.z;
+	current.u = u;
+	current.v = v;
+	vertices.push_back(current);
+
+	// the 4th vertex of a quad completes the triangles 0-1-2 and 0-2-3
+	if (++quad_vertices == 4) {
+		std::size_t n = vertices.size();
+		vertices.push_back(vertices[n-4]);
+		vertices.push_back(vertices[n-2]);
+		commands.back().count += 6;
+		quad_vertices = 0;
+	}
+}
+
+void CRenderQueue::End() {
+	// drop an incomplete quad
+	vertices.resize(commands.back().first + commands.back().count);
+	quad_vertices = 0;
+}
+
+void CRenderQueue::Draw(const GLubyte* data) {
+	const GLsizei stride = sizeof(TRenderVertex);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, stride, data + offsetof(TRenderVertex, x));
+	glNormalPointer(GL_FLOAT, stride, data + offsetof(TRenderVertex, nx));
+	glTexCoordPointer(2, GL_FLOAT, stride, data + offsetof(TRenderVertex, u));
+	glColorPointer(4, GL_UNSIGNED_BYTE, stride, data + offsetof(TRenderVertex, col));
+
+	TRenderMode mode = RM_UNINITIALIZED;
+	TTexture* texture = nullptr;
+	std::size_t first = 0;
+	for (std::size_t i = 0; i < commands.size(); i++) {
+		const TRenderCommand& cmd = commands[i];
+		if (cmd.count > 0) {
+			if (cmd.mode != mode) {
+				if (mode != RM_UNINITIALIZED) PopRenderMode();
+				mode = cmd.mode;
+				PushRenderMode(mode);
+				set_material(colWhite, colBlack, 1.0);
+				glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+				texture = nullptr;
+			}
+			if (cmd.texture != texture) {
+				texture = cmd.texture;
+				if (texture != nullptr) texture->Bind();
+			}
+			glDrawArrays(GL_TRIANGLES, (GLint)first, (GLsizei)cmd.count);
+			draw_calls++;
+			num_draw_calls++;
+		}
+		first += cmd.count;
+	}
+	if (mode != RM_UNINITIALIZED) PopRenderMode();
+
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glColor4f(1.f, 1.f, 1.f, 1.f);
+}
+
+void CRenderQueue::Flush() {
+	draw_calls = 0;
+	if (commands.empty()) return;
+
+	// sort the commands by state and rearrange the vertices accordingly,
+	// afterwards commands with equal state are merged
+	std::stable_sort(commands.begin(), commands.end(), [](const TRenderCommand& l, const TRenderCommand& r) -> bool {
+		if (l.mode != r.mode) return l.mode < r.mode;
+		return SortByTexture(l.mode) && l.texture < r.texture;
+	});
+	sorted.clear();
+	std::size_t merged = 0;
+	for (std::size_t i = 0; i < commands.size(); i++) {
+		const TRenderCommand& cmd = commands[i];
+		sorted.insert(sorted.end(), vertices.begin() + cmd.first,
+		              vertices.begin() + cmd.first + cmd.count);
+		if (merged > 0 && commands[merged-1].mode == cmd.mode &&
+		        commands[merged-1].texture == cmd.texture) {
+			commands[merged-1].count += cmd.count;
+		} else {
+			commands[merged++] = cmd;
+		}
+	}
+	commands.resize(merged);
+
+	if (HaveBufferObjects() && !sorted.empty()) {
+		std::size_t size = sorted.size() * sizeof(TRenderVertex);
+		if (buffer == 0) glGenBuffers_p(1, &buffer);
+		glBindBuffer_p(GL_ARRAY_BUFFER, buffer);
+		if (size > buffer_size) {
+			buffer_size = std::max(size, 2 * buffer_size);
+		}
+		// orphan the storage of the last frame, so no sync is needed
+		glBufferData_p(GL_ARRAY_BUFFER, buffer_size, nullptr, GL_STREAM_DRAW);
+		glBufferSubData_p(GL_ARRAY_BUFFER, 0, size, &sorted[0]);
+		Draw((const GLubyte*)nullptr);
+		glBindBuffer_p(GL_ARRAY_BUFFER, 0);
+	} else if (!sorted.empty()) {
+		Draw((const GLubyte*)&sorted[0]);
+	}
+
+	vertices.clear();
+	commands.clear();
+	quad_vertices = 0;
+}
@@ -0,0 +1,80 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+/* --------------------------------------------------------------------
+A per-frame command buffer for the small objects of the racing scene.
+Instead of drawing immediately, subsystems submit quads together with
+the render mode and texture they need. Flush sorts the commands by
+render mode, and by texture in the modes that don't blend, copies all
+vertices into one streaming buffer and issues a single draw call per
+state. Blended commands keep the order in which they were submitted.
+--------------------------------------------------------------------- */
+
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "bh.h"
+#include "ogl.h"
+#include <vector>
+
+class TTexture;
+
+struct TRenderVertex {
+	GLfloat x, y, z;
+	GLfloat nx, ny, nz;
+	GLfloat u, v;
+	GLubyte col[4];
+};
+
+class CRenderQueue {
+private:
+	struct TRenderCommand {
+		TRenderMode mode;
+		TTexture* texture;
+		std::size_t first;
+		std::size_t count;
+	};
+
+	std::vector<TRenderVertex> vertices;
+	std::vector<TRenderVertex> sorted;
+	std::vector<TRenderCommand> commands;
+	TRenderVertex current;
+	std::size_t quad_vertices;
+	std::size_t draw_calls;
+	GLuint buffer;
+	std::size_t buffer_size;
+
+	void Draw(const GLubyte* data);
+public:
+	CRenderQueue();
+
+	// The vertices between Begin and End are grouped to quads, in the
+	// same order as with GL_QUADS. Normal and colour are sticky.
+	void Begin(TRenderMode mode, TTexture* texture);
+	void Normal(const TVector3d& nml);
+	void Color(const sf::Color& col);
+	void Vertex(const TVector3d& pt, float u, float v);
+	void End();
+
+	// draws and clears all submitted commands
+	void Flush();
+	std::size_t DrawCalls() const { return draw_calls; }	// of the last flush
+};
+
+extern CRenderQueue RenderQueue;
+
+#endif
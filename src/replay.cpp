@@ -0,0 +1,377 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "replay.h"
+#include "course.h"
+#include "env.h"
+#include "game_ctrl.h"
+#include "particles.h"
+#include "physics.h"
+#include "racing.h"
+#include "states.h"
+#include "tux.h"
+#include "spx.h"
+#include <fstream>
+#include <iostream>
+
+#define REPLAY_MAGIC "ETRR"
+#define REPLAY_VERSION 1
+#define MAX_REPLAY_STRING 1024
+
+CReplay Replay;
+
+// The values are written in the byte order of the machine.
+template<typename T>
+static void Write(std::ostream& os, const T& value) {
+	os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void WriteString(std::ostream& os, const std::string& str) {
+	Write(os, (uint16_t)str.size());
+	os.write(str.data(), str.size());
+}
+
+template<typename T>
+static bool Read(std::istream& is, T& value) {
+	return (bool)is.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+static bool ReadString(std::istream& is, std::string& str) {
+	uint16_t size;
+	if (!Read(is, size) || size > MAX_REPLAY_STRING) return false;
+	str.resize(size);
+	return size == 0 || (bool)is.read(&str[0], size);
+}
+
+CReplay::CReplay()
+	: mode(REPLAY_OFF), played(false), step(0), run_pos(0), run_done(0), reset_pos(0)
+	, mirror(false), light_id(0), snow_id(0), wind_id(0), wind_seed(0)
+	, start_x(0), start_z(0), start_time(0)
+	, end_time(0), end_herring(0) {}
+
+// --------------------------------------------------------------------
+//				recording
+// --------------------------------------------------------------------
+
+// Called before the player is initialized at the start point.
+void CReplay::StartRecording(const CControl *ctrl) {
+	mode = REPLAY_RECORD;
+	runs.clear();
+	resets.clear();
+	step = 0;
+
+	course_group = Course.currentCourseList->name;
+	course_dir = g_game.course->dir;
+	char_dir = g_game.character->dir;
+	mirror = g_game.mirrorred;
+	light_id = (int)g_game.light_id;
+	snow_id = g_game.snow_id;
+	wind_id = g_game.wind_id;
+	wind_seed = Wind.Seed();
+	start_x = ctrl->cpos.x;
+	start_z = ctrl->cpos.z;
+	start_time = g_game.time;
+}
+
+void CReplay::Record(const TReplayInput& input) {
+	if (runs.empty() || !(runs.back().input == input) || runs.back().count == 0xffff) {
+		TRun run;
+		run.count = 0;
+		run.input = input;
+		runs.push_back(run);
+	}
+	runs.back().count++;
+	step++;
+}
+
+// Called after the player is initialized at the reset point.
+void CReplay::RecordReset(const CControl *ctrl) {
+	TReset reset;
+	reset.step = step;
+	reset.x = ctrl->cpos.x;
+	reset.z = ctrl->cpos.z;
+	reset.time = g_game.time;
+	resets.push_back(reset);
+}
+
+void CReplay::StopRecording(const CControl *ctrl) {
+	mode = REPLAY_OFF;
+	end_pos = ctrl->cpos;
+	end_time = g_game.time;
+	end_herring = g_game.herring;
+
+	std::string path = param.save_dir + SEP "replay_" + GetTimeString() + ".etrr";
+	if (Save(path))
+		Message("race recorded to", path);
+	else
+		Message("could not write the replay", path);
+}
+
+bool CReplay::Save(const std::string& path) const {
+	std::ofstream file(path.c_str(), std::ios::binary);
+	if (!file) return false;
+
+	file.write(REPLAY_MAGIC, 4);
+	Write(file, (uint32_t)REPLAY_VERSION);
+	WriteString(file, course_group);
+	WriteString(file, course_dir);
+	WriteString(file, char_dir);
+	Write(file, (uint8_t)mirror);
+	Write(file, (int32_t)light_id);
+	Write(file, (int32_t)snow_id);
+	Write(file, (int32_t)wind_id);
+	Write(file, wind_seed);
+	Write(file, start_x);
+	Write(file, start_z);
+	Write(file, start_time);
+
+	Write(file, (uint32_t)runs.size());
+	for (std::size_t i = 0; i < runs.size(); i++) {
+		Write(file, runs[i].count);
+		Write(file, runs[i].input.flags);
+		Write(file, runs[i].input.turnfact);
+	}
+	Write(file, (uint32_t)resets.size());
+	for (std::size_t i = 0; i < resets.size(); i++) {
+		Write(file, resets[i].step);
+		Write(file, resets[i].x);
+		Write(file, resets[i].z);
+		Write(file, resets[i].time);
+	}
+
+	Write(file, end_pos.x);
+	Write(file, end_pos.y);
+	Write(file, end_pos.z);
+	Write(file, end_time);
+	Write(file, (int32_t)end_herring);
+	return (bool)file;
+}
+
+// --------------------------------------------------------------------
+//				playback
+// --------------------------------------------------------------------
+
+bool CReplay::Load(const std::string& path) {
+	mode = REPLAY_OFF;
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file) {
+		Message("could not open the replay", path);
+		return false;
+	}
+
+	char magic[4];
+	uint32_t version = 0;
+	if (!file.read(magic, 4) || std::string(magic, 4) != REPLAY_MAGIC ||
+	        !Read(file, version) || version != REPLAY_VERSION) {
+		Message("not a replay of this version", path);
+		return false;
+	}
+
+	uint8_t mirrored = 0;
+	int32_t light = 0, snow = 0, wind = 0, herring = 0;
+	uint32_t num_runs = 0, num_resets = 0;
+	bool ok = ReadString(file, course_group) && ReadString(file, course_dir) &&
+	          ReadString(file, char_dir) && Read(file, mirrored) &&
+	          Read(file, light) && Read(file, snow) && Read(file, wind) &&
+	          Read(file, wind_seed) && Read(file, start_x) && Read(file, start_z) &&
+	          Read(file, start_time) && Read(file, num_runs);
+
+	runs.clear();
+	for (uint32_t i = 0; ok && i < num_runs; i++) {
+		TRun run;
+		ok = Read(file, run.count) && Read(file, run.input.flags) && Read(file, run.input.turnfact);
+		runs.push_back(run);
+	}
+	ok = ok && Read(file, num_resets);
+	resets.clear();
+	for (uint32_t i = 0; ok && i < num_resets; i++) {
+		TReset reset;
+		ok = Read(file, reset.step) && Read(file, reset.x) && Read(file, reset.z) && Read(file, reset.time);
+		resets.push_back(reset);
+	}
+	ok = ok && Read(file, end_pos.x) && Read(file, end_pos.y) && Read(file, end_pos.z) &&
+	     Read(file, end_time) && Read(file, herring);
+	if (!ok) {
+		Message("the replay is damaged", path);
+		return false;
+	}
+
+	mirror = mirrored != 0;
+	light_id = light;
+	snow_id = snow;
+	wind_id = wind;
+	end_herring = herring;
+	mode = REPLAY_PLAY;
+	Rewind();
+	return true;
+}
+
+void CReplay::Rewind() {
+	step = 0;
+	run_pos = 0;
+	run_done = 0;
+	reset_pos = 0;
+}
+
+bool CReplay::TakeReset(double& x, double& z, double& time) {
+	if (reset_pos >= resets.size() || resets[reset_pos].step != step)
+		return false;
+	x = resets[reset_pos].x;
+	z = resets[reset_pos].z;
+	time = resets[reset_pos].time;
+	reset_pos++;
+	return true;
+}
+
+bool CReplay::Next(TReplayInput& input) {
+	while (run_pos < runs.size() && run_done >= runs[run_pos].count) {
+		run_pos++;
+		run_done = 0;
+	}
+	if (run_pos >= runs.size())
+		return false;
+	input = runs[run_pos].input;
+	run_done++;
+	step++;
+	return true;
+}
+
+static CCourseList* FindCourseGroup(const std::string& name) {
+	std::unordered_map<std::string, CCourseList>::iterator group = Course.CourseLists.find(name);
+	return group == Course.CourseLists.end() ? nullptr : &group->second;
+}
+
+static TCourse* FindCourse(CCourseList* group, const std::string& dir) {
+	for (std::size_t i = 0; i < group->size(); i++)
+		if ((*group)[i].dir == dir) return &(*group)[i];
+	return nullptr;
+}
+
+bool CReplay::SetupGame() {
+	CCourseList* group = FindCourseGroup(course_group);
+	TCourse* course = group ? FindCourse(group, course_dir) : nullptr;
+	if (course == nullptr) {
+		Message("the course of the replay is missing", course_group + SEP + course_dir);
+		return false;
+	}
+	TCharacter* character = nullptr;
+	for (std::size_t i = 0; i < Char.CharList.size(); i++)
+		if (Char.CharList[i].dir == char_dir) character = &Char.CharList[i];
+	if (character == nullptr) {
+		Message("the character of the replay is missing", char_dir);
+		return false;
+	}
+
+	Players.AllocControl(0);
+	g_game.player = Players.GetPlayer(0);
+	g_game.character = character;
+	Course.currentCourseList = group;
+	g_game.course = course;
+	g_game.theme_id = course->music_theme;
+	g_game.mirrorred = mirror;
+	g_game.light_id = light_id;
+	g_game.snow_id = snow_id;
+	g_game.wind_id = wind_id;
+	g_game.game_type = PRACTICING;
+	Rewind();
+	return true;
+}
+
+// --------------------------------------------------------------------
+//				headless replay
+// --------------------------------------------------------------------
+
+// The course is loaded without textures and the steps run as fast as
+// they can, on private copies of the shape, the wind and the items.
+int CReplay::RunHeadless() {
+	g_game.player = nullptr;
+	g_game.character = nullptr;
+	g_game.force_treemap = false;
+	g_game.treesize = 3;
+	g_game.treevar = 3;
+
+	Course.headless = true;
+	Course.MakeStandardPolyhedrons();
+	if (!Course.LoadObjectTypes() || !Course.LoadTerrainTypes() ||
+	        !Env.LoadEnvironmentList() || !Course.LoadCourseList()) {
+		Message("could not load the course data");
+		return -1;
+	}
+	CCourseList* group = FindCourseGroup(course_group);
+	TCourse* course = group ? FindCourse(group, course_dir) : nullptr;
+	if (course == nullptr) {
+		Message("the course of the replay is missing", course_group + SEP + course_dir);
+		return -1;
+	}
+	Course.currentCourseList = group;
+	g_game.course = course;
+	g_game.mirrorred = mirror;
+	if (!Course.LoadCourse(course))
+		return -1;
+
+	CCharShape shape;
+	if (!shape.Load(param.char_dir + SEP + char_dir, "shape.lst", false)) {
+		Message("the character of the replay is missing", char_dir);
+		return -1;
+	}
+	CWind wind;
+	wind.Init(wind_id, wind_seed);
+
+	TSimContext context;
+	context.shape = &shape;
+	context.wind = &wind;
+	context.items.resize(Course.NocollArr.size());
+	for (std::size_t i = 0; i < context.items.size(); i++)
+		context.items[i] = Course.NocollArr[i].collectable != -1 ? 1 : -1;
+
+	CControl ctrl;
+	ctrl.sim = &context;
+	ctrl.cpos.x = start_x;
+	ctrl.cpos.z = start_z;
+	ctrl.Init();
+	g_game.time = start_time;
+	g_game.herring = 0;
+	g_game.finish = false;
+
+	Rewind();
+	std::vector<TParticleEmission> emissions;
+	sf::Clock clock;
+	while (!ctrl.game_over) {
+		wind.Update(SIM_TIMESTEP);
+		SimulateRaceStep(&ctrl, SIM_TIMESTEP, 0.f);
+		take_queued_emissions(emissions);
+		emissions.clear();
+		context.collected.clear();
+	}
+	float seconds = clock.getElapsedTime().asSeconds();
+
+	double dist = (ctrl.cpos - end_pos).Length();
+	bool same = dist < 1e-6 && std::fabs(g_game.time - end_time) < 1e-4 && g_game.herring == end_herring;
+	std::cout << "replay: " << step << " steps in " << seconds * 1000.f << " ms, "
+	          << (seconds > 0.f ? step / seconds : 0.f) << " steps/s\n"
+	          << "time " << g_game.time << " (recorded " << end_time << "), herring "
+	          << g_game.herring << " (recorded " << end_herring << "), end position off by "
+	          << dist << '\n'
+	          << (same ? "the replay matches the recording\n" : "the replay differs from the recording\n");
+
+	Course.ResetCourse();
+	return same ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+/* --------------------------------------------------------------------
+Recording and replay of races. A recording holds the race settings, the
+seed of the wind, the start of the player and the input state of every
+fixed simulation step, stored as runs of equal states. As the physics
+only depends on these, feeding the input back step by step repeats the
+race. A replay is watched with --replay <file> or run without a window
+at full speed with --replay-headless <file>, which compares the result
+with the recorded one.
+--------------------------------------------------------------------- */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "bh.h"
+#include <vector>
+
+// input flags of a step
+#define REPLAY_LEFT				0x0001
+#define REPLAY_RIGHT			0x0002
+#define REPLAY_STICK_TURN		0x0004
+#define REPLAY_KEY_PADDLE		0x0008
+#define REPLAY_STICK_PADDLE		0x0010
+#define REPLAY_KEY_BRAKE		0x0020
+#define REPLAY_STICK_BRAKE		0x0040
+#define REPLAY_KEY_CHARGE		0x0080
+#define REPLAY_STICK_CHARGE		0x0100
+#define REPLAY_TRICK			0x0200
+
+struct TReplayInput {
+	uint16_t flags;
+	float turnfact;		// position of the stick
+
+	bool operator==(const TReplayInput& other) const {
+		return flags == other.flags && turnfact == other.turnfact;
+	}
+};
+
+class CReplay {
+private:
+	struct TRun {
+		uint16_t count;
+		TReplayInput input;
+	};
+	// a reset of the player, placed before the step
+	struct TReset {
+		uint32_t step;
+		double x;
+		double z;
+		double time;
+	};
+	enum TMode { REPLAY_OFF, REPLAY_RECORD, REPLAY_PLAY };
+
+	TMode mode;
+	bool played;		// the last race was a replay
+	std::vector<TRun> runs;
+	std::vector<TReset> resets;
+	uint32_t step;		// steps recorded or played
+	std::size_t run_pos;
+	uint16_t run_done;	// steps played of the current run
+	std::size_t reset_pos;
+
+	bool Save(const std::string& path) const;
+public:
+	// the race of the recording
+	std::string course_group;
+	std::string course_dir;
+	std::string char_dir;
+	bool mirror;
+	int light_id;
+	int snow_id;
+	int wind_id;
+	uint64_t wind_seed;
+	double start_x;
+	double start_z;
+	double start_time;
+	// the result at the end of the recording
+	TVector3d end_pos;
+	double end_time;
+	int end_herring;
+
+	CReplay();
+
+	bool Recording() const { return mode == REPLAY_RECORD; }
+	bool Playing() const { return mode == REPLAY_PLAY; }
+	std::size_t Steps() const { return step; }
+
+	void StartRecording(const CControl *ctrl);
+	void Record(const TReplayInput& input);
+	void RecordReset(const CControl *ctrl);
+	void StopRecording(const CControl *ctrl);
+
+	bool Load(const std::string& path);
+	void Rewind();
+	// the reset before the next step, false if there is none
+	bool TakeReset(double& x, double& z, double& time);
+	// the input of the next step, false at the end of the recording
+	bool Next(TReplayInput& input);
+	void Stop() { played = mode == REPLAY_PLAY; mode = REPLAY_OFF; }
+	// true after the end of a watched replay, which is not scored
+	bool Played() const { return played; }
+
+	// sets up g_game for watching the replay, after the lists are loaded
+	bool SetupGame();
+	// runs the replay without a window and prints the result
+	int RunHeadless();
+};
+
+extern CReplay Replay;
+
+#endif
@@ -33,6 +33,7 @@ GNU General Public License for more details.
 #include "racing.h"
 #include "winsys.h"
 #include "physics.h"
+#include "render_queue.h"
 
 #define BLINK_IN_PLACE_TIME 0.5
 #define TOTAL_RESET_TIME 1.0
@@ -66,6 +67,7 @@ void CReset::Loop(float time_step) {
 	RenderCourse();
 	DrawTrackmarks();
 	DrawTrees();
+	RenderQueue.Flush();
 
 	if (elapsed_time > BLINK_IN_PLACE_TIME && !position_reset) {
 		// Determine optimal location for reset
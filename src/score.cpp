@@ -29,6 +29,7 @@ GNU General Public License for more details.
 #include "course.h"
 #include "spx.h"
 #include "winsys.h"
+#include "ghost.h"
 
 CScore Score;
 
@@ -155,7 +156,9 @@ int CScore::CalcRaceResult() {
 	g_game.score = (int)(herringpt + timept);
 	if (g_game.score < 0) g_game.score = 0;
 
-	return AddScore(Course.currentCourseList->name, g_game.course->dir, TScore(g_game.player->name, g_game.score, g_game.herring, g_game.time));
+	int pos = AddScore(Course.currentCourseList->name, g_game.course->dir, TScore(g_game.player->name, g_game.score, g_game.herring, g_game.time));
+	if (pos == 0) Ghost.SaveBest(Course.currentCourseList->name, g_game.course->dir);
+	return pos;
 }
 
 // --------------------------------------------------------------------
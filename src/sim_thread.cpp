@@ -0,0 +1,180 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "sim_thread.h"
+#include "course.h"
+#include "game_ctrl.h"
+#include "states.h"
+#include "tux.h"
+#include "input.h"
+
+#define SNAPSHOT_SLOT 3u
+#define SNAPSHOT_NEW 4u
+
+CSimThread SimThread;
+
+CSimThread::CSimThread()
+	: latest(0), write_slot(1), read_slot(2), read_time(0.f), input_base(0.f)
+	, running(false), step(nullptr), shape(nullptr), shape_char(nullptr) {
+	context.shape = nullptr;
+	context.wind = nullptr;
+}
+
+CSimThread::~CSimThread() {
+	if (thread.joinable()) {
+		running = false;
+		thread.join();
+	}
+	delete shape;
+}
+
+// The steps follow the clock as in State::Manager, after a long stall at
+// most MAX_SIM_STEPS are run and the rest of the time is dropped.
+void CSimThread::Run() {
+	float sim_time = 0.f;	// clock time of the simulated state
+	while (running) {
+		float now = clock.getElapsedTime().asSeconds();
+		if (sim_time + SIM_TIMESTEP > now || ctrl.game_over) {
+			sf::sleep(sf::seconds(std::max(sim_time + SIM_TIMESTEP - now, 0.001f)));
+			continue;
+		}
+
+		int steps = 0;
+		while (sim_time + SIM_TIMESTEP <= now && !ctrl.game_over) {
+			if (steps == MAX_SIM_STEPS) {
+				sim_time = now;
+				break;
+			}
+			wind.Update(SIM_TIMESTEP);
+			step(&ctrl, SIM_TIMESTEP, input_base + sim_time + SIM_TIMESTEP);
+			sim_time += SIM_TIMESTEP;
+			steps++;
+		}
+		Publish(sim_time);
+	}
+}
+
+void CSimThread::Publish(float step_time) {
+	TSimSnapshot& snap = slots[write_slot];
+	snap.ctrl = ctrl;
+	shape->GetTransforms(snap.joints, snap.inv_joints);
+	snap.wind = wind;
+	take_queued_emissions(snap.emissions);
+	snap.collected.insert(snap.collected.end(), context.collected.begin(), context.collected.end());
+	context.collected.clear();
+	float applied = Input.TakeApplied();
+	if (snap.input_time < 0.f || (applied >= 0.f && applied < snap.input_time))
+		snap.input_time = applied;
+	snap.time = g_game.time;
+	snap.herring = g_game.herring;
+	snap.finish = g_game.finish;
+	snap.step_time = step_time;
+
+	unsigned int prev = latest.exchange(write_slot | SNAPSHOT_NEW, std::memory_order_acq_rel);
+	write_slot = prev & SNAPSHOT_SLOT;
+	// the events of a snapshot the renderer has skipped go with the next one
+	if (!(prev & SNAPSHOT_NEW)) {
+		slots[write_slot].emissions.clear();
+		slots[write_slot].collected.clear();
+		slots[write_slot].input_time = -1.f;
+	}
+}
+
+const TSimSnapshot* CSimThread::Take() {
+	if (!(latest.load(std::memory_order_acquire) & SNAPSHOT_NEW))
+		return nullptr;
+	unsigned int prev = latest.exchange(read_slot, std::memory_order_acq_rel);
+	read_slot = prev & SNAPSHOT_SLOT;
+	read_time = slots[read_slot].step_time;
+	return &slots[read_slot];
+}
+
+float CSimThread::Alpha() const {
+	float alpha = (clock.getElapsedTime().asSeconds() - read_time) / SIM_TIMESTEP;
+	return clamp(0.f, alpha, 1.f);
+}
+
+// The thread gets its own copy of the shape, loaded once per character,
+// and copies of the player, the wind and the item flags.
+bool CSimThread::Start(CControl *player, void (*step_func)(CControl *ctrl, float timestep, float step_time)) {
+	if (thread.joinable())
+		return true;
+
+	if (shape_char != g_game.character) {
+		delete shape;
+		shape = new CCharShape;
+		shape_char = g_game.character;
+		if (!shape->Load(param.char_dir + SEP + g_game.character->dir, "shape.lst", false)) {
+			Message("could not load the character shape for the physics thread");
+			delete shape;
+			shape = nullptr;
+			shape_char = nullptr;
+			return false;
+		}
+	}
+	std::vector<TMatrix<4, 4> > trans, invtrans;
+	g_game.character->shape->GetTransforms(trans, invtrans);
+	shape->SetTransforms(trans, invtrans);
+
+	wind = Wind;
+	context.shape = shape;
+	context.wind = &wind;
+	context.items.resize(Course.NocollArr.size());
+	for (std::size_t i = 0; i < context.items.size(); i++)
+		context.items[i] = Course.NocollArr[i].collectable;
+	context.collected.clear();
+	ctrl = *player;
+	ctrl.sim = &context;
+
+	for (int i = 0; i < 3; i++) {
+		slots[i].emissions.clear();
+		slots[i].collected.clear();
+		slots[i].input_time = -1.f;
+	}
+	latest = 0;
+	write_slot = 1;
+	read_slot = 2;
+	read_time = 0.f;
+
+	step = step_func;
+	running = true;
+	clock.restart();
+	input_base = Input.Now();
+	thread = std::thread(&CSimThread::Run, this);
+	return true;
+}
+
+// Joins the thread and hands its final state to the player, including
+// the steps of a snapshot the renderer has not taken.
+void CSimThread::Stop(CControl *player) {
+	if (!thread.joinable())
+		return;
+	running = false;
+	thread.join();
+
+	player->CopySimState(ctrl);
+	std::vector<TMatrix<4, 4> > trans, invtrans;
+	shape->GetTransforms(trans, invtrans);
+	g_game.character->shape->SetTransforms(trans, invtrans);
+	Wind = wind;
+	for (std::size_t i = 0; i < context.items.size() && i < Course.NocollArr.size(); i++)
+		Course.NocollArr[i].collectable = context.items[i];
+}
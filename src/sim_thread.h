@@ -0,0 +1,93 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+/* --------------------------------------------------------------------
+The race physics on its own thread. The thread runs the fixed steps of
+the simulation on private copies of the control, the character shape,
+the wind and the item flags. After the steps of a turn it writes a
+snapshot of the results, which the renderer takes without waiting: three
+snapshot slots are exchanged through one atomic index, so the writer
+always has a free slot and the reader always gets the newest snapshot.
+--------------------------------------------------------------------- */
+
+#ifndef SIM_THREAD_H
+#define SIM_THREAD_H
+
+#include "bh.h"
+#include "physics.h"
+#include "particles.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+class CCharShape;
+struct TCharacter;
+
+struct TSimSnapshot {
+	CControl ctrl;
+	std::vector<TMatrix<4, 4> > joints;		// node transforms of the shape
+	std::vector<TMatrix<4, 4> > inv_joints;
+	CWind wind;
+	// events since the last snapshot the renderer has taken
+	std::vector<TParticleEmission> emissions;
+	std::vector<std::size_t> collected;
+	float input_time;	// first input event taken, negative if none
+	float time;
+	int herring;
+	bool finish;
+	float step_time;	// clock time of the last step
+};
+
+class CSimThread {
+private:
+	TSimSnapshot slots[3];
+	std::atomic<unsigned int> latest;	// slot index, SNAPSHOT_NEW if not taken yet
+	unsigned int write_slot;
+	unsigned int read_slot;
+	float read_time;
+	float input_base;	// input clock time of the clock start
+
+	std::thread thread;
+	std::atomic<bool> running;
+	sf::Clock clock;
+	void (*step)(CControl *ctrl, float timestep, float step_time);
+
+	// owned by the thread while it runs
+	CControl ctrl;
+	TSimContext context;
+	CWind wind;
+	CCharShape *shape;
+	const TCharacter *shape_char;
+
+	void Run();
+	void Publish(float step_time);
+public:
+	CSimThread();
+	~CSimThread();
+
+	bool Active() const { return thread.joinable(); }
+	bool Start(CControl *player, void (*step_func)(CControl *ctrl, float timestep, float step_time));
+	void Stop(CControl *player);
+	// the newest snapshot, nullptr if there is none since the last call
+	const TSimSnapshot* Take();
+	// part of a step between the taken snapshot and now
+	float Alpha() const;
+};
+
+extern CSimThread SimThread;
+
+#endif
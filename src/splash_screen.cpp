@@ -32,6 +32,8 @@ GNU General Public License for more details.
 #include "translation.h"
 #include "score.h"
 #include "regist.h"
+#include "loading.h"
+#include "replay.h"
 #include "winsys.h"
 
 CSplashScreen SplashScreen;
@@ -94,7 +96,12 @@ void CSplashScreen::Loop(float time_step) {
 		} else
 			reason += Trans.Text(94) + "\n";
 
-		if (reason.isEmpty())
+		if (reason.isEmpty() && g_game.argument == 6) {
+			if (Replay.SetupGame())
+				State::manager.RequestEnterState(Loading);
+			else
+				State::manager.RequestQuit();
+		} else if (reason.isEmpty())
 			State::manager.RequestEnterState(Regist);
 		else { // Failure
 			FT.AutoSizeN(6);
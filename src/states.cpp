@@ -22,6 +22,9 @@ GNU General Public License for more details.
 #include "states.h"
 #include "ogl.h"
 #include "winsys.h"
+#include "frame_pacer.h"
+#include "input.h"
+#include "telemetry.h"
 
 State::Manager State::manager(Winsys);
 
@@ -33,7 +36,11 @@ State::Manager::~Manager() {
 void State::Manager::Run(State& entranceState) {
 	current = &entranceState;
 	current->Enter();
+	FramePacer.Reset();
 	while (!quit) {
+		// the events are polled during the wait and again after it, so
+		// they are read as late as possible
+		FramePacer.Wait([this]() { PollEvent(); });
 		PollEvent();
 		if (next)
 			EnterNextState();
@@ -49,6 +56,7 @@ void State::Manager::EnterNextState() {
 	previous = current;
 	current = next;
 	next = nullptr;
+	sim_time = 0.f;
 	current->Enter();
 }
 
@@ -120,5 +128,22 @@ void State::Manager::CallLoopFunction() {
 
 	g_game.time_step = std::max(0.0001f, timer.getElapsedTime().asSeconds());
 	timer.restart();
+	float now = Input.Now();
+
+	sim_time += g_game.time_step;
+	int steps = 0;
+	while (sim_time >= SIM_TIMESTEP && !next) {
+		if (steps == MAX_SIM_STEPS) {
+			sim_time = 0.f;
+			break;
+		}
+		step_time = now - sim_time + SIM_TIMESTEP;
+		current->Update(SIM_TIMESTEP);
+		sim_time -= SIM_TIMESTEP;
+		steps++;
+	}
+	sim_alpha = sim_time / SIM_TIMESTEP;
+
 	current->Loop(g_game.time_step);
+	Telemetry.Update();
 }
@@ -23,6 +23,13 @@ GNU General Public License for more details.
 
 class CWinsys;
 
+// The simulation of a state runs in Update with a fixed step, independent
+// of the frame rate. After a long frame at most MAX_SIM_STEPS are run, the
+// rest of the time is dropped, so the simulation slows down instead of
+// spiralling.
+#define SIM_TIMESTEP (1.f / 100.f)
+#define MAX_SIM_STEPS 10
+
 class State {
 	State(const State&) = delete;
 	State& operator=(const State&) = delete;
@@ -37,8 +44,11 @@ public:
 		State* current;
 		State* next;
 		sf::Clock timer;
+		float sim_time;		// not yet simulated time
+		float sim_alpha;
+		float step_time;	// input clock time at the end of the running step
 		bool quit;
-		explicit Manager(CWinsys& winsys) : Winsys(winsys), previous(nullptr), current(nullptr), next(nullptr), quit(false) {}
+		explicit Manager(CWinsys& winsys) : Winsys(winsys), previous(nullptr), current(nullptr), next(nullptr), sim_time(0.f), sim_alpha(1.f), step_time(0.f), quit(false) {}
 		Manager(const Manager&);
 		Manager& operator=(const Manager&) = delete;
 		~Manager();
@@ -52,10 +62,15 @@ public:
 		void Run(State& entranceState);
 		State* PreviousState() { return previous; }
 		State* CurrentState() { return current; }
+		State* NextState() { return next; }	// set during the Exit of a state
+		// part of a simulation step between the last step and the frame
+		float SimAlpha() const { return sim_alpha; }
+		float StepTime() const { return step_time; }
 	};
 	static Manager manager;
 
 	virtual void Enter() {}
+	virtual void Update(float timestep) {}	// fixed step, before Loop
 	virtual void Loop(float time_step) {}
 	virtual void Keyb(sf::Keyboard::Key key, bool release, int x, int y) {}
 	virtual void Mouse(int button, int state, int x, int y) {}
@@ -0,0 +1,194 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "telemetry.h"
+#include "game_config.h"
+#include "ogl.h"
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#define TELEMETRY_INTERVAL 1.f	// s between the dumps
+
+#define TELEMETRY_OFF 0
+#define TELEMETRY_FILE 1
+#define TELEMETRY_SOCKET 2
+
+static const char* counter_names[NUM_COUNTERS] = {
+	"frames",
+	"ode_steps",
+	"collision_tests",
+	"draw_calls",
+	"texture_binds",
+	"quadtree_nodes",
+	"particles"
+};
+
+CTelemetry Telemetry;
+
+CTelemetry::CTelemetry() : last_dump(0.f), last_format(0.f), mode(TELEMETRY_OFF), listen_fd(-1) {
+	for (std::size_t i = 0; i < NUM_COUNTERS; i++) {
+		counters[i].value.store(0, std::memory_order_relaxed);
+		last[i] = 0;
+	}
+}
+
+CTelemetry::~CTelemetry() {
+	CloseSocket();
+}
+
+void CTelemetry::Init() {
+	CloseSocket();
+	mode = param.telemetry;
+	if (mode == TELEMETRY_SOCKET && !OpenSocket()) {
+		Message("telemetry: no local socket, writing to a file instead");
+		mode = TELEMETRY_FILE;
+	}
+	if (mode == TELEMETRY_FILE)
+		path = param.save_dir + SEP "telemetry.txt";
+	clock.restart();
+	last_dump = 0.f;
+	last_format = 0.f;
+}
+
+bool CTelemetry::OpenSocket() {
+#ifdef _WIN32
+	return false;
+#else
+	path = param.save_dir + SEP "telemetry.sock";
+	sockaddr_un addr;
+	if (path.size() >= sizeof(addr.sun_path)) {
+		Message("telemetry: socket path too long", path);
+		return false;
+	}
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	std::strcpy(addr.sun_path, path.c_str());
+
+	listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd < 0)
+		return false;
+	unlink(path.c_str());	// left over by a crashed run
+	if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, 4) < 0) {
+		Message("telemetry: could not listen on", path);
+		close(listen_fd);
+		listen_fd = -1;
+		return false;
+	}
+	fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+	return true;
+#endif
+}
+
+void CTelemetry::CloseSocket() {
+#ifndef _WIN32
+	if (listen_fd >= 0) {
+		close(listen_fd);
+		unlink(path.c_str());
+		listen_fd = -1;
+	}
+#endif
+}
+
+std::string CTelemetry::Format(float now) {
+	float interval = now - last_format;
+	int64_t values[NUM_COUNTERS];
+	for (std::size_t i = 0; i < NUM_COUNTERS; i++)
+		values[i] = Get((TCounter)i);
+	int64_t frames = values[CNT_FRAMES] - last[CNT_FRAMES];
+
+	std::ostringstream os;
+	os << std::fixed << std::setprecision(2);
+	os << "uptime " << now << '\n';
+	os << "interval " << interval << '\n';
+	os << "fps " << (interval > 0.f ? frames / interval : 0.f) << '\n';
+	for (std::size_t i = 0; i < NUM_COUNTERS; i++) {
+		os << counter_names[i] << ' ' << values[i] << '\n';
+		if (i != CNT_FRAMES && i < FIRST_GAUGE) {
+			double per_frame = frames > 0 ? (double)(values[i] - last[i]) / frames : 0.0;
+			os << counter_names[i] << "_per_frame " << per_frame << '\n';
+		}
+	}
+	std::memcpy(last, values, sizeof(last));
+	last_format = now;
+	return os.str();
+}
+
+void CTelemetry::WriteFile(const std::string& text) const {
+	// readers never see a half written file
+	std::string tmp = path + ".tmp";
+	FILE* file = std::fopen(tmp.c_str(), "wb");
+	if (file == nullptr)
+		return;
+	bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+	ok = std::fclose(file) == 0 && ok;
+#ifdef _WIN32
+	std::remove(path.c_str());
+#endif
+	if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0)
+		std::remove(tmp.c_str());
+}
+
+// Answers the waiting clients with one dump each, the dump is small enough
+// for the socket buffer.
+void CTelemetry::Serve(float now) {
+#ifndef _WIN32
+	int client = accept(listen_fd, nullptr, nullptr);
+	if (client < 0)
+		return;
+	std::string text = Format(now);
+#ifdef MSG_NOSIGNAL
+	const int flags = MSG_NOSIGNAL;
+#else
+	const int flags = 0;
+#endif
+	do {
+		send(client, text.data(), text.size(), flags);
+		close(client);
+		client = accept(listen_fd, nullptr, nullptr);
+	} while (client >= 0);
+#endif
+}
+
+void CTelemetry::Update() {
+	Add(CNT_FRAMES);
+	Add(CNT_DRAW_CALLS, num_draw_calls);
+	num_draw_calls = 0;
+
+	if (mode == TELEMETRY_OFF)
+		return;
+	float now = clock.getElapsedTime().asSeconds();
+	if (now - last_dump < TELEMETRY_INTERVAL)
+		return;
+	last_dump = now;
+
+	if (mode == TELEMETRY_SOCKET)
+		Serve(now);
+	else
+		WriteFile(Format(now));
+}
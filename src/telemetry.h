@@ -0,0 +1,89 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+/* --------------------------------------------------------------------
+Runtime counters. The subsystems count with relaxed atomic additions,
+from any thread, and each counter has its own cache line. Once a second
+the counters are written as "name value" lines, depending on
+param.telemetry to telemetry.txt in the save directory or to the clients
+of the local socket telemetry.sock. Without a waiting client nothing is
+formatted.
+--------------------------------------------------------------------- */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "bh.h"
+#include <atomic>
+#include <cstdint>
+
+enum TCounter {
+	// totals since the start
+	CNT_FRAMES,
+	CNT_ODE_STEPS,			// integration steps of the ode solver
+	CNT_COLLISION_TESTS,	// trees tested against the player shape
+	CNT_DRAW_CALLS,
+	CNT_TEXTURE_BINDS,
+	// current values
+	CNT_QUADTREE_NODES,		// enabled children of the terrain quadtree
+	CNT_PARTICLES,			// living snow particles
+	NUM_COUNTERS
+};
+
+#define FIRST_GAUGE CNT_QUADTREE_NODES
+
+class CTelemetry {
+private:
+	struct alignas(64) TSlot {
+		std::atomic<int64_t> value;
+	};
+	TSlot counters[NUM_COUNTERS];
+	int64_t last[NUM_COUNTERS];	// totals of the last dump
+	sf::Clock clock;
+	float last_dump;
+	float last_format;	// time of the totals in last
+	int mode;
+	std::string path;
+	int listen_fd;
+
+	bool OpenSocket();
+	void CloseSocket();
+	std::string Format(float now);
+	void WriteFile(const std::string& text) const;
+	void Serve(float now);
+public:
+	CTelemetry();
+	~CTelemetry();
+
+	void Add(TCounter counter, int64_t num = 1) {
+		counters[counter].value.fetch_add(num, std::memory_order_relaxed);
+	}
+	void Set(TCounter counter, int64_t num) {
+		counters[counter].value.store(num, std::memory_order_relaxed);
+	}
+	int64_t Get(TCounter counter) const {
+		return counters[counter].value.load(std::memory_order_relaxed);
+	}
+
+	void Init();
+	// called once per frame, writes the counters when the interval is over
+	void Update();
+};
+
+extern CTelemetry Telemetry;
+
+#endif
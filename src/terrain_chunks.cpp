@@ -0,0 +1,426 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+#ifdef HAVE_CONFIG_H
+#include <etr_config.h>
+#endif
+
+#include "terrain_chunks.h"
+#include "textures.h"
+#include "course.h"
+#include "view.h"
+#include "ogl.h"
+#include <vector>
+#include <cstdint>
+
+#define CHUNK_SIZE 16			// quads along the edge of a patch
+#define CHUNK_VERTS (CHUNK_SIZE + 1)
+#define CHUNK_LEVELS 5			// step widths 1, 2, 4, 8 and 16
+#define CHUNK_MORPH_START 0.6f	// part of a lod range without morphing
+#define CHUNK_RANGE_SCALE 0.4f	// range of level 0 per course_detail_level
+
+struct TChunkVertex {
+	GLfloat x, y, z;
+	GLfloat nx, ny, nz;
+};
+
+struct TChunkRange {
+	GLintptr first;		// byte offset in the index list
+	GLsizei count;
+};
+
+struct TChunk {
+	TVector3d min;
+	TVector3d max;
+	std::size_t first_vertex;
+	std::size_t first_range;	// CHUNK_LEVELS * (num_terrains + 1) ranges
+	int level;					// currently morphed level, -1 = none
+};
+
+static const CourseFields* grid_fields = nullptr;
+static int grid_nx = 0;
+static int grid_nz = 0;
+static std::size_t num_terrains = 0;
+static double min_range = 0;
+
+static std::vector<TChunk> chunks;
+static std::vector<TChunk*> visible;
+static std::vector<TChunkVertex> vertices;
+static std::vector<GLfloat> fine_y;
+static std::vector<unsigned char> vertex_level;
+static std::vector<GLuint> indices;
+static std::vector<TChunkRange> ranges;
+static std::vector<GLubyte> weights;
+static std::vector<GLintptr> terrain_weights;	// per terrain, -1 if unused
+static std::vector<GLintptr> special_weights;
+
+static GLuint vertex_buffer = 0;
+static GLuint weight_buffer = 0;
+static GLuint index_buffer = 0;
+
+static const GLvoid* BufferPtr(const void* base, GLintptr offset) {
+	return reinterpret_cast<const GLvoid*>(reinterpret_cast<std::uintptr_t>(base) + offset);
+}
+
+static std::size_t GridIndex(int x, int z) {
+	if (x >= grid_nx) x = grid_nx - 1;
+	if (z >= grid_nz) z = grid_nz - 1;
+	return x + grid_nx * z;
+}
+
+// the coarsest level that still contains the patch vertex (i, k)
+static int LocalVertexLevel(int i, int k) {
+	int level = 0;
+	while (level < CHUNK_LEVELS - 1) {
+		int step = 2 << level;
+		if (i % step != 0 || k % step != 0) break;
+		level++;
+	}
+	return level;
+}
+
+// current height of the patch vertex (i, k) on the surface of the next
+// coarser level, from its already morphed parents; the coarse quads are
+// split along the same diagonal as in BuildLevel
+static GLfloat CoarseHeight(std::size_t first, int i, int k, int level) {
+	int h = 1 << level;
+	bool odd_i = (i % (2 * h)) != 0;
+	bool odd_k = (k % (2 * h)) != 0;
+	int di = odd_i ? h : 0;
+	int dk = odd_k ? h : 0;
+	const TChunkVertex& a = vertices[first + (i - di) + (k - dk) * CHUNK_VERTS];
+	const TChunkVertex& b = vertices[first + (i + di) + (k + dk) * CHUNK_VERTS];
+	return 0.5f * (a.y + b.y);
+}
+
+static void AddRange(TChunkRange* range, const std::vector<GLuint>& tris,
+                     const std::vector<uint8_t>& terrain, int j) {
+	range->first = indices.size() * sizeof(GLuint);
+	for (std::size_t t = 0; t < tris.size(); t += 3) {
+		int ta = terrain[tris[t]];
+		int tb = terrain[tris[t+1]];
+		int tc = terrain[tris[t+2]];
+		bool take;
+		if (j < 0)	// triangles with three different terrains
+			take = ta != tb && ta != tc && tb != tc;
+		else
+			take = ta == j || tb == j || tc == j;
+		if (take) indices.insert(indices.end(), &tris[t], &tris[t] + 3);
+	}
+	range->count = (GLsizei)(indices.size() - range->first / sizeof(GLuint));
+}
+
+static void BuildLevel(const TChunk& chunk, int level, const std::vector<uint8_t>& terrain) {
+	static std::vector<GLuint> tris;
+	tris.clear();
+
+	int h = 1 << level;
+	GLuint base = (GLuint)chunk.first_vertex;
+	for (int k = 0; k < CHUNK_SIZE; k += h) {
+		for (int i = 0; i < CHUNK_SIZE; i += h) {
+			GLuint a = base + k * CHUNK_VERTS + i;
+			GLuint b = a + h;
+			GLuint c = b + h * CHUNK_VERTS;
+			GLuint d = a + h * CHUNK_VERTS;
+			tris.push_back(a);
+			tris.push_back(b);
+			tris.push_back(c);
+			tris.push_back(a);
+			tris.push_back(c);
+			tris.push_back(d);
+		}
+	}
+
+	TChunkRange* range = &ranges[chunk.first_range + level * (num_terrains + 1)];
+	for (std::size_t j = 0; j < num_terrains; j++) {
+		if (terrain_weights[j] >= 0)
+			AddRange(&range[j], tris, terrain, (int)j);
+	}
+	AddRange(&range[num_terrains], tris, terrain, -1);
+}
+
+static void AddWeights(std::vector<GLintptr>& offsets, std::size_t j,
+                       const std::vector<uint8_t>& terrain, bool exact) {
+	offsets[j] = weights.size();
+	weights.resize(weights.size() + 4 * terrain.size(), 255);
+	GLubyte* w = &weights[offsets[j]];
+	for (std::size_t v = 0; v < terrain.size(); v++) {
+		if (exact)
+			w[4*v+3] = (terrain[v] == j) ? 255 : 0;
+		else
+			w[4*v+3] = (terrain[v] >= j) ? 255 : 0;
+	}
+}
+
+void ResetTerrainChunks() {
+	if (vertex_buffer != 0) glDeleteBuffers_p(1, &vertex_buffer);
+	if (weight_buffer != 0) glDeleteBuffers_p(1, &weight_buffer);
+	if (index_buffer != 0) glDeleteBuffers_p(1, &index_buffer);
+	vertex_buffer = weight_buffer = index_buffer = 0;
+
+	chunks.clear();
+	visible.clear();
+	vertices.clear();
+	fine_y.clear();
+	vertex_level.clear();
+	indices.clear();
+	ranges.clear();
+	weights.clear();
+	terrain_weights.clear();
+	special_weights.clear();
+}
+
+void InitTerrainChunks(const CourseFields* fields, int nx, int nz,
+                       double scalex, double scalez) {
+	ResetTerrainChunks();
+	if (nx < 2 || nz < 2) return;
+
+	grid_fields = fields;
+	grid_nx = nx;
+	grid_nz = nz;
+	num_terrains = Course.TerrList.size();
+	min_range = 1.1 * CHUNK_SIZE * std::hypot(scalex, scalez);
+
+	int chunks_x = (nx - 2) / CHUNK_SIZE + 1;
+	int chunks_z = (nz - 2) / CHUNK_SIZE + 1;
+	std::size_t num_verts = (std::size_t)chunks_x * chunks_z * CHUNK_VERTS * CHUNK_VERTS;
+
+	chunks.resize(chunks_x * chunks_z);
+	vertices.resize(num_verts);
+	fine_y.resize(num_verts);
+	vertex_level.resize(num_verts);
+	ranges.resize(chunks.size() * CHUNK_LEVELS * (num_terrains + 1));
+	std::vector<uint8_t> terrain(num_verts);
+
+	std::size_t v = 0;
+	for (int cz = 0; cz < chunks_z; cz++) {
+		for (int cx = 0; cx < chunks_x; cx++) {
+			TChunk& chunk = chunks[cx + cz * chunks_x];
+			chunk.first_vertex = v;
+			chunk.first_range = (cx + cz * chunks_x) * CHUNK_LEVELS * (num_terrains + 1);
+			chunk.level = -1;
+
+			for (int k = 0; k < CHUNK_VERTS; k++) {
+				for (int i = 0; i < CHUNK_VERTS; i++, v++) {
+					int x = cx * CHUNK_SIZE + i;
+					int z = cz * CHUNK_SIZE + k;
+					const CourseFields& field = fields[GridIndex(x, z)];
+
+					vertices[v].x = std::min(x, nx - 1) * scalex;
+					vertices[v].y = field.elevation;
+					vertices[v].z = std::min(z, nz - 1) * scalez;
+					vertices[v].nx = field.nml.x;
+					vertices[v].ny = field.nml.y;
+					vertices[v].nz = field.nml.z;
+
+					fine_y[v] = field.elevation;
+					vertex_level[v] = LocalVertexLevel(i, k);
+					terrain[v] = field.terrain;
+
+					TVector3d pt(vertices[v].x, vertices[v].y, vertices[v].z);
+					if (i == 0 && k == 0) {
+						chunk.min = chunk.max = pt;
+					} else {
+						chunk.min.x = std::min(chunk.min.x, pt.x);
+						chunk.min.y = std::min(chunk.min.y, pt.y);
+						chunk.min.z = std::min(chunk.min.z, pt.z);
+						chunk.max.x = std::max(chunk.max.x, pt.x);
+						chunk.max.y = std::max(chunk.max.y, pt.y);
+						chunk.max.z = std::max(chunk.max.z, pt.z);
+					}
+				}
+			}
+		}
+	}
+
+	terrain_weights.assign(num_terrains, -1);
+	special_weights.assign(num_terrains, -1);
+	for (std::size_t j = 0; j < num_terrains; j++) {
+		if (Course.TerrList[j].texture == nullptr) continue;
+		AddWeights(terrain_weights, j, terrain, false);
+		AddWeights(special_weights, j, terrain, true);
+	}
+
+	for (std::size_t c = 0; c < chunks.size(); c++) {
+		for (int level = 0; level < CHUNK_LEVELS; level++)
+			BuildLevel(chunks[c], level, terrain);
+	}
+
+	if (HaveBufferObjects()) {
+		glGenBuffers_p(1, &vertex_buffer);
+		glBindBuffer_p(GL_ARRAY_BUFFER, vertex_buffer);
+		glBufferData_p(GL_ARRAY_BUFFER, vertices.size() * sizeof(TChunkVertex),
+		               &vertices[0], GL_DYNAMIC_DRAW);
+
+		glGenBuffers_p(1, &weight_buffer);
+		glBindBuffer_p(GL_ARRAY_BUFFER, weight_buffer);
+		glBufferData_p(GL_ARRAY_BUFFER, weights.size(),
+		               weights.empty() ? nullptr : &weights[0], GL_STATIC_DRAW);
+		glBindBuffer_p(GL_ARRAY_BUFFER, 0);
+
+		glGenBuffers_p(1, &index_buffer);
+		glBindBuffer_p(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+		glBufferData_p(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+		               indices.empty() ? nullptr : &indices[0], GL_STATIC_DRAW);
+		glBindBuffer_p(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		// the index list and the weights are only needed on the gpu
+		std::vector<GLuint>().swap(indices);
+		std::vector<GLubyte>().swap(weights);
+	}
+}
+
+// --------------------------------------------------------------------
+//				rendering
+// --------------------------------------------------------------------
+
+static double BoxDistance(const TChunk& chunk, const TVector3d& pos) {
+	double dx = std::max(0.0, std::max(chunk.min.x - pos.x, pos.x - chunk.max.x));
+	double dz = std::max(0.0, std::max(chunk.min.z - pos.z, pos.z - chunk.max.z));
+	return std::sqrt(dx * dx + dz * dz);
+}
+
+// The height of a vertex depends only on the vertex and the viewer: it
+// is morphed by the range of its own level, not by the level of the
+// patch, so the copies of a border vertex in two patches of different
+// levels always agree. The levels are processed from coarse to fine, and
+// a fully morphed vertex lies on the edge between its morphed parents.
+static void MorphChunk(TChunk& chunk, int level, const TVector3d& view_pos, double range0) {
+	const std::size_t first = chunk.first_vertex;
+	const std::size_t last = first + CHUNK_VERTS * CHUNK_VERTS;
+	bool changed = false;
+	chunk.level = level;
+
+	for (int l = CHUNK_LEVELS - 2; l >= level; l--) {
+		int h = 1 << l;
+		double range = range0 * (1 << l);
+		double start = range * CHUNK_MORPH_START;
+		double scale = 1.0 / (range - start);
+		for (int k = 0; k < CHUNK_VERTS; k += h) {
+			for (int i = 0; i < CHUNK_VERTS; i += h) {
+				std::size_t v = first + i + k * CHUNK_VERTS;
+				if (vertex_level[v] != l) continue;
+
+				double dx = vertices[v].x - view_pos.x;
+				double dz = vertices[v].z - view_pos.z;
+				double morph = clamp(0.0, (std::sqrt(dx * dx + dz * dz) - start) * scale, 1.0);
+				GLfloat y = fine_y[v];
+				if (morph > 0.0)
+					y += (CoarseHeight(first, i, k, l) - y) * (GLfloat)morph;
+				if (y != vertices[v].y) {
+					vertices[v].y = y;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	if (changed && vertex_buffer != 0) {
+		glBufferSubData_p(GL_ARRAY_BUFFER, first * sizeof(TChunkVertex),
+		                  (last - first) * sizeof(TChunkVertex), &vertices[first]);
+	}
+}
+
+static std::size_t DrawChunkRanges(std::size_t range_idx, const void* index_base) {
+	std::size_t triangles = 0;
+	for (std::size_t c = 0; c < visible.size(); c++) {
+		const TChunk* chunk = visible[c];
+		const TChunkRange& range =
+		    ranges[chunk->first_range + chunk->level * (num_terrains + 1) + range_idx];
+		if (range.count == 0) continue;
+
+		glDrawElements(GL_TRIANGLES, range.count, GL_UNSIGNED_INT,
+		               BufferPtr(index_base, range.first));
+		triangles += range.count / 3;
+		num_draw_calls++;
+	}
+	return triangles;
+}
+
+std::size_t RenderTerrainChunks(const TVector3d& view_pos, float detail) {
+	if (chunks.empty()) return 0;
+
+	const void* vertex_base = vertex_buffer ? nullptr : vertices.data();
+	const void* weight_base = weight_buffer ? nullptr : weights.data();
+	const void* index_base = index_buffer ? nullptr : indices.data();
+	if (vertex_buffer) glBindBuffer_p(GL_ARRAY_BUFFER, vertex_buffer);
+
+	double range0 = std::max((double)detail * CHUNK_RANGE_SCALE, min_range);
+	visible.clear();
+	for (std::size_t c = 0; c < chunks.size(); c++) {
+		TChunk& chunk = chunks[c];
+		if (clip_aabb_to_view_frustum(chunk.min, chunk.max) == NotVisible)
+			continue;
+
+		double dist = BoxDistance(chunk, view_pos);
+		double range = range0;
+		int level = 0;
+		while (level < CHUNK_LEVELS - 1 && dist >= range) {
+			level++;
+			range *= 2;
+		}
+		MorphChunk(chunk, level, view_pos, range0);
+		visible.push_back(&chunk);
+	}
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(TChunkVertex), vertex_base);
+	glNormalPointer(GL_FLOAT, sizeof(TChunkVertex), BufferPtr(vertex_base, 3 * sizeof(GLfloat)));
+
+	if (weight_buffer) glBindBuffer_p(GL_ARRAY_BUFFER, weight_buffer);
+	if (index_buffer) glBindBuffer_p(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+
+	std::size_t triangles = 0;
+	for (std::size_t j = 0; j < num_terrains; j++) {
+		if (terrain_weights[j] < 0) continue;
+		Course.TerrList[j].texture->Bind();
+		glColorPointer(4, GL_UNSIGNED_BYTE, 0, BufferPtr(weight_base, terrain_weights[j]));
+		triangles += DrawChunkRanges(j, index_base);
+	}
+
+	if (param.perf_level > 1) {
+		glDisable(GL_FOG);
+		glDisableClientState(GL_COLOR_ARRAY);
+		glColor4ub(0, 0, 0, 255);
+		Course.TerrList[0].texture->Bind();
+		std::size_t special = DrawChunkRanges(num_terrains, index_base);
+		glEnableClientState(GL_COLOR_ARRAY);
+		glEnable(GL_FOG);
+
+		if (special > 0) {
+			triangles += special;
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+			for (std::size_t j = 0; j < num_terrains; j++) {
+				if (special_weights[j] < 0) continue;
+				Course.TerrList[j].texture->Bind();
+				glColorPointer(4, GL_UNSIGNED_BYTE, 0, BufferPtr(weight_base, special_weights[j]));
+				triangles += DrawChunkRanges(num_terrains, index_base);
+			}
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		}
+	}
+
+	if (vertex_buffer) glBindBuffer_p(GL_ARRAY_BUFFER, 0);
+	if (index_buffer) glBindBuffer_p(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+	return triangles;
+}
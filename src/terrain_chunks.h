@@ -0,0 +1,42 @@
+/* --------------------------------------------------------------------
+EXTREME TUXRACER
+
+Copyright (C) 2010 Extreme Tuxracer Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+---------------------------------------------------------------------*/
+
+
+/* --------------------------------------------------------------------
+Chunked LOD terrain, an alternative to the quadtree renderer. The course
+is divided into square patches of a fixed size. Every patch has
+precomputed index lists for each LOD level, the level is selected by the
+distance to the viewer. Vertices that vanish at the next coarser level
+are morphed towards the coarse surface before the level switches, so
+neither popping nor cracks between neighbouring patches occur.
+--------------------------------------------------------------------- */
+
+#ifndef TERRAIN_CHUNKS_H
+#define TERRAIN_CHUNKS_H
+
+#include "bh.h"
+#include "mathlib.h"
+
+struct CourseFields;
+
+void ResetTerrainChunks();
+void InitTerrainChunks(const CourseFields* fields, int nx, int nz,
+                       double scalex, double scalez);
+
+// returns the number of submitted triangles
+std::size_t RenderTerrainChunks(const TVector3d& view_pos, float detail);
+
+#endif
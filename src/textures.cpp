@@ -24,6 +24,7 @@ GNU General Public License for more details.
 #include "winsys.h"
 #include "ogl.h"
 #include "gui.h"
+#include "telemetry.h"
 #include <cctype>
 
 
@@ -50,6 +51,7 @@ bool TTexture::Load(const std::string& dir, const std::string& filename, bool re
 }
 
 void TTexture::Bind() {
+	Telemetry.Add(CNT_TEXTURE_BINDS);
 	sf::Texture::bind(&texture);
 }
 
@@ -76,6 +78,7 @@ void TTexture::Draw() {
 	glVertexPointer(2, GL_INT, 0, vtx);
 	glTexCoordPointer(2, GL_SHORT, 0, fullsize_texture);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	num_draw_calls++;
 
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	glDisableClientState(GL_VERTEX_ARRAY);
@@ -114,6 +117,7 @@ void TTexture::Draw(int x, int y, float size) {
 	glVertexPointer(2, GL_FLOAT, 0, vtx);
 	glTexCoordPointer(2, GL_SHORT, 0, fullsize_texture);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	num_draw_calls++;
 
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	glDisableClientState(GL_VERTEX_ARRAY);
@@ -145,6 +149,7 @@ void TTexture::Draw(int x, int y, float width, float height) {
 	glVertexPointer(2, GL_FLOAT, 0, vtx);
 	glTexCoordPointer(2, GL_SHORT, 0, fullsize_texture);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	num_draw_calls++;
 
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	glDisableClientState(GL_VERTEX_ARRAY);
@@ -279,6 +284,7 @@ void CTexture::DrawNumChr(char c, int x, int y, int w, int h) {
 	glVertexPointer(2, GL_FLOAT, 0, vtx);
 	glTexCoordPointer(2, GL_FLOAT, 0, tex);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	num_draw_calls++;
 }
 
 void CTexture::DrawNumStr(const std::string& s, int x, int y, float size, const sf::Color& col) {
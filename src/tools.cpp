@@ -148,6 +148,7 @@ void DrawQuad(float x, float y, float w, float h, float scrheight, const sf::Col
 
 	glVertexPointer(2, GL_FLOAT, 0, vtx);
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	num_draw_calls++;
 
 	glDisableClientState(GL_VERTEX_ARRAY);
 	glEnable(GL_TEXTURE_2D);
@@ -24,13 +24,14 @@ GNU General Public License for more details.
 #include "textures.h"
 #include "course.h"
 #include "physics.h"
-#include <list>
+#include "effect_budget.h"
+#include <vector>
+#include <cstddef>
 
 #define TRACK_WIDTH 0.7
-#define MAX_TRACK_MARKS 10000
 #define SPEED_TO_START_TRENCH 0.0
-#define TRACK_HEIGHT 0.08
 #define MAX_TRACK_DEPTH 0.7
+#define NO_TRACK_MARK ((std::size_t)-1)
 
 
 enum track_types_t {
@@ -40,176 +41,283 @@ enum track_types_t {
 	NUM_TRACK_TYPES
 };
 
-struct track_quad_t {
-	TVector3d v1, v2, v3, v4;
-	TVector2d t1, t2, t3, t4;
-	TVector3d n1, n2, n3, n4;
-	track_types_t track_type;
-	uint8_t alpha;
+struct track_vertex_t {
+	GLfloat x, y, z;
+	GLfloat nx, ny, nz;
+	GLfloat u, v;
+	GLubyte col[4];
 };
 
+// The marks of each terrain type are kept in their own decal store, a ring
+// of quad slots. Its size comes from the profile of the terrain type, so
+// the memory per type is bounded, and it is only allocated when the first
+// mark is made on that terrain. The ring is mirrored in buffer objects.
+// Every slot has 4 vertices (v1..v4) and 6 indices in each of the per-type
+// index lists; in the lists of the other types the indices are collapsed
+// to degenerate triangles. So a store is drawn with one call per track
+// texture, and only the slots changed since the last frame are uploaded.
 struct track_marks_t {
-	std::list<track_quad_t> quads;
-	std::list<track_quad_t>::iterator current_mark;
+	std::vector<track_vertex_t> vertices;
+	std::vector<GLuint> indices[NUM_TRACK_TYPES];
+	std::vector<track_types_t> types;
+	std::vector<std::size_t> dirty;	// slots to upload
+	std::size_t capacity;	// 0 = terrain without marks
+	std::size_t count;		// used slots
+	std::size_t current;	// slot of the last mark
+
+	int textures[NUM_TRACK_TYPES];
+	float height;			// above the surface
+
+	GLuint vertex_buffer;
+	GLuint index_buffers[NUM_TRACK_TYPES];
+	bool uploaded;			// buffer objects contain all used slots
 };
 
-static track_marks_t track_marks;
+static std::vector<track_marks_t> track_stores;	// by terrain index
+static track_marks_t* track_store = nullptr;	// store of the continuing track
 static bool continuing_track;
 
-static int trackid1 = 1;
-static int trackid2 = 2;
-static int trackid3 = 3;
-
-void SetTrackIDs(int id1, int id2, int id3) {
-	trackid1 = id1;
-	trackid2 = id2;
-	trackid3 = id3;
+static void ReleaseTrackStore(track_marks_t& tm) {
+	if (tm.vertex_buffer != 0) {
+		glDeleteBuffers_p(1, &tm.vertex_buffer);
+		glDeleteBuffers_p(NUM_TRACK_TYPES, tm.index_buffers);
+		tm.vertex_buffer = 0;
+	}
+	tm.vertices.clear();
+	tm.vertices.shrink_to_fit();
+	for (int t=0; t<NUM_TRACK_TYPES; t++) {
+		tm.indices[t].clear();
+		tm.indices[t].shrink_to_fit();
+	}
+	tm.types.clear();
+	tm.types.shrink_to_fit();
 }
 
+// Takes the profiles of the terrain types of the current course. The old
+// marks are dropped.
 void init_track_marks() {
-	track_marks.quads.clear();
-	track_marks.current_mark = track_marks.quads.begin();
+	for (std::size_t i=0; i<track_stores.size(); i++)
+		ReleaseTrackStore(track_stores[i]);
+	track_stores.resize(Course.TerrList.size());
+
+	for (std::size_t i=0; i<track_stores.size(); i++) {
+		const TTerrType& terr = Course.TerrList[i];
+		track_marks_t& tm = track_stores[i];
+		tm.dirty.clear();
+		tm.capacity = 0;
+		tm.count = 0;
+		tm.current = NO_TRACK_MARK;
+		tm.textures[TRACK_HEAD] = terr.starttex;
+		tm.textures[TRACK_MARK] = terr.tracktex;
+		tm.textures[TRACK_TAIL] = terr.stoptex;
+		tm.height = terr.track_height;
+		tm.vertex_buffer = 0;
+		tm.uploaded = false;
+		if (terr.trackmarks && terr.starttex >= 0 && terr.tracktex >= 0 && terr.stoptex >= 0)
+			tm.capacity = terr.max_tracks;
+	}
+	track_store = nullptr;
 	continuing_track = false;
 }
 
-template<typename T>
-static T incrementRingIterator(T q) {
-	T ret = q;
-	++ret;
-	if (ret == track_marks.quads.end())
-		ret = track_marks.quads.begin();
-	return ret;
+static void AllocTrackStore(track_marks_t& tm) {
+	if (!tm.vertices.empty()) return;
+	tm.vertices.resize(4 * tm.capacity);
+	for (int t=0; t<NUM_TRACK_TYPES; t++)
+		tm.indices[t].resize(6 * tm.capacity);
+	tm.types.resize(tm.capacity);
 }
 
-template<typename T>
-static T decrementRingIterator(T q) {
-	T ret = q;
-	if (ret == track_marks.quads.begin())
-		return track_marks.quads.end();
-	--ret;
-	return ret;
+static std::size_t PrevTrackSlot(const track_marks_t& tm, std::size_t slot) {
+	if (slot > 0) return slot - 1;
+	if (tm.count == tm.capacity) return tm.capacity - 1;
+	return NO_TRACK_MARK;
 }
 
-void DrawTrackmarks() {
-	if (param.perf_level < 3 || track_marks.quads.empty())
-		return;
-
-	TTexture* textures[NUM_TRACK_TYPES];
+static track_vertex_t* TrackQuad(track_marks_t& tm, std::size_t slot) {
+	return &tm.vertices[4 * slot];
+}
 
-	sf::Color track_colour = colWhite;
-	set_material(track_colour, colBlack, 1.0);
-	ScopedRenderMode rm(TRACK_MARKS);
+static void SetTrackType(track_marks_t& tm, std::size_t slot, track_types_t type) {
+	tm.types[slot] = type;
 
-	textures[TRACK_HEAD] = Tex.GetTexture(trackid1);
-	textures[TRACK_MARK] = Tex.GetTexture(trackid2);
-	textures[TRACK_TAIL] = Tex.GetTexture(trackid3);
+	// triangles v1-v2-v4 and v1-v4-v3
+	static const GLuint order[6] = { 0, 1, 3, 0, 3, 2 };
+	GLuint first = (GLuint)(4 * slot);
+	for (int t=0; t<NUM_TRACK_TYPES; t++) {
+		GLuint* idx = &tm.indices[t][6 * slot];
+		for (int i=0; i<6; i++)
+			idx[i] = (t == type) ? first + order[i] : first;
+	}
+	tm.dirty.push_back(slot);
+}
 
-	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+static void SetTrackVertex(track_vertex_t* vert, const TVector3d& pt, double u, double v) {
+	vert->x = pt.x;
+	vert->y = pt.y;
+	vert->z = pt.z;
+	TVector3d nml = Course.FindCourseNormal(pt.x, pt.z);
+	vert->nx = nml.x;
+	vert->ny = nml.y;
+	vert->nz = nml.z;
+	vert->u = u;
+	vert->v = v;
+	vert->col[0] = vert->col[1] = vert->col[2] = 255;
+}
 
-	for (std::list<track_quad_t>::const_iterator q = track_marks.quads.begin(); q != track_marks.quads.end(); ++q) {
-		if (q->alpha != track_colour.a) {
-			track_colour.a = q->alpha;
-			set_material_diffuse(track_colour);
+static void UploadTrackMarks(track_marks_t& tm) {
+	if (tm.vertex_buffer == 0) {
+		glGenBuffers_p(1, &tm.vertex_buffer);
+		glBindBuffer_p(GL_ARRAY_BUFFER, tm.vertex_buffer);
+		glBufferData_p(GL_ARRAY_BUFFER, tm.vertices.size() * sizeof(track_vertex_t),
+		               nullptr, GL_DYNAMIC_DRAW);
+		glGenBuffers_p(NUM_TRACK_TYPES, tm.index_buffers);
+		for (int t=0; t<NUM_TRACK_TYPES; t++) {
+			glBindBuffer_p(GL_ELEMENT_ARRAY_BUFFER, tm.index_buffers[t]);
+			glBufferData_p(GL_ELEMENT_ARRAY_BUFFER, tm.indices[t].size() * sizeof(GLuint),
+			               nullptr, GL_DYNAMIC_DRAW);
 		}
-		textures[q->track_type]->Bind();
-
-		if ((q->track_type == TRACK_HEAD) || (q->track_type == TRACK_TAIL)) {
-			glBegin(GL_QUADS);
-
-			glNormal3(q->n1);
-			glTexCoord2(q->t1);
-			glVertex3(q->v1);
-
-			glNormal3(q->n2);
-			glTexCoord2(q->t2);
-			glVertex3(q->v2);
-
-			glNormal3(q->n4);
-			glTexCoord2(q->t4);
-			glVertex3(q->v4);
+	}
 
-			glNormal3(q->n3);
-			glTexCoord2(q->t3);
-			glVertex3(q->v3);
+	glBindBuffer_p(GL_ARRAY_BUFFER, tm.vertex_buffer);
+	if (!tm.uploaded) {
+		glBufferSubData_p(GL_ARRAY_BUFFER, 0, 4 * tm.count * sizeof(track_vertex_t),
+		                  &tm.vertices[0]);
+		for (int t=0; t<NUM_TRACK_TYPES; t++) {
+			glBindBuffer_p(GL_ELEMENT_ARRAY_BUFFER, tm.index_buffers[t]);
+			glBufferSubData_p(GL_ELEMENT_ARRAY_BUFFER, 0, 6 * tm.count * sizeof(GLuint),
+			                  &tm.indices[t][0]);
+		}
+		tm.uploaded = true;
+	} else {
+		for (std::size_t i=0; i<tm.dirty.size(); i++) {
+			std::size_t slot = tm.dirty[i];
+			glBufferSubData_p(GL_ARRAY_BUFFER, 4 * slot * sizeof(track_vertex_t),
+			                  4 * sizeof(track_vertex_t), TrackQuad(tm, slot));
+			for (int t=0; t<NUM_TRACK_TYPES; t++) {
+				glBindBuffer_p(GL_ELEMENT_ARRAY_BUFFER, tm.index_buffers[t]);
+				glBufferSubData_p(GL_ELEMENT_ARRAY_BUFFER, 6 * slot * sizeof(GLuint),
+				                  6 * sizeof(GLuint), &tm.indices[t][6 * slot]);
+			}
+		}
+	}
+	tm.dirty.clear();
+}
 
-			glEnd();
+// The effect budget limits the drawn marks to the newest ones, which are
+// one or two ranges of the ring.
+static void DrawTrackStore(track_marks_t& tm, bool vbo) {
+	std::size_t num = std::min(tm.count, (std::size_t)(tm.capacity * EffectBudget.Scale(EFFECT_TRACKS)));
+	if (num == 0) {
+		return;
+	}
 
-		} else {
-			glBegin(GL_QUAD_STRIP);
-			glNormal3(q->n2);
-			glTexCoord2(q->t2);
-			glVertex3(q->v2);
+	std::size_t first = (tm.current + tm.capacity + 1 - num) % tm.capacity;
+	std::size_t ranges[2][2] = {{ first, std::min(first + num, tm.capacity) }, { 0, 0 }};
+	if (first + num > tm.capacity)
+		ranges[1][1] = first + num - tm.capacity;
 
-			glNormal3(q->n1);
-			glTexCoord2(q->t1);
-			glVertex3(q->v1);
+	const GLubyte* base = (const GLubyte*)&tm.vertices[0];
+	if (vbo) {
+		UploadTrackMarks(tm);
+		base = nullptr;
+	} else {
+		tm.dirty.clear();
+	}
 
-			glNormal3(q->n4);
-			glTexCoord2(q->t4);
-			glVertex3(q->v4);
+	const GLsizei stride = sizeof(track_vertex_t);
+	glVertexPointer(3, GL_FLOAT, stride, base + offsetof(track_vertex_t, x));
+	glNormalPointer(GL_FLOAT, stride, base + offsetof(track_vertex_t, nx));
+	glTexCoordPointer(2, GL_FLOAT, stride, base + offsetof(track_vertex_t, u));
+	glColorPointer(4, GL_UNSIGNED_BYTE, stride, base + offsetof(track_vertex_t, col));
+
+	for (int t=0; t<NUM_TRACK_TYPES; t++) {
+		Tex.BindTex(tm.textures[t]);
+		if (vbo) glBindBuffer_p(GL_ELEMENT_ARRAY_BUFFER, tm.index_buffers[t]);
+		for (int r=0; r<2; r++) {
+			if (ranges[r][1] == ranges[r][0]) continue;
+			GLsizei num_indices = (GLsizei)(6 * (ranges[r][1] - ranges[r][0]));
+			if (vbo) {
+				glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_INT,
+				               (const GLvoid*)(6 * ranges[r][0] * sizeof(GLuint)));
+			} else {
+				glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_INT, &tm.indices[t][6 * ranges[r][0]]);
+			}
+			num_draw_calls++;
+		}
+	}
+}
 
-			glNormal3(q->n3);
-			glTexCoord2(q->t3);
-			glVertex3(q->v3);
+void DrawTrackmarks() {
+	if (!EffectBudget.Enabled(EFFECT_TRACKS))
+		return;
+	CEffectBudget::Timer timer(EFFECT_TRACKS);
 
-			std::list<track_quad_t>::const_iterator qnext = q;
-			++qnext;
-			while (qnext != track_marks.quads.end() && qnext->track_type != TRACK_TAIL) {
-				q = qnext;
-				if (q->alpha != track_colour.a) {
-					track_colour.a = q->alpha;
-					set_material_diffuse(track_colour);
-				}
+	set_material(colWhite, colBlack, 1.0);
+	ScopedRenderMode rm(TRACK_MARKS);
+	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 
-				glNormal3(q->n4);
-				glTexCoord2(q->t4);
-				glVertex3(q->v4);
+	bool vbo = HaveBufferObjects();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
 
-				glNormal3(q->n3);
-				glTexCoord2(q->t3);
-				glVertex3(q->v3);
+	for (std::size_t i=0; i<track_stores.size(); i++) {
+		if (track_stores[i].count > 0)
+			DrawTrackStore(track_stores[i], vbo);
+	}
 
-				++qnext;
-			}
-			glEnd();
-		}
+	if (vbo) {
+		glBindBuffer_p(GL_ARRAY_BUFFER, 0);
+		glBindBuffer_p(GL_ELEMENT_ARRAY_BUFFER, 0);
 	}
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
 }
 
 void break_track_marks() {
 	if (!continuing_track)
 		return;
 
-	std::list<track_quad_t>::iterator q = track_marks.current_mark;
-	if (q != track_marks.quads.end()) {
-		q->track_type = TRACK_TAIL;
-		q->t1 = TVector2d(0.0, 0.0);
-		q->t2 = TVector2d(1.0, 0.0);
-		q->t3 = TVector2d(0.0, 1.0);
-		q->t4 = TVector2d(1.0, 1.0);
-		std::list<track_quad_t>::iterator qprev = decrementRingIterator(q);
-		if (qprev != track_marks.quads.end()) {
-			qprev->t3.y = std::max(qprev->t3.y+0.5, qprev->t1.y+1.0);
-			qprev->t4.y = std::max(qprev->t3.y+0.5, qprev->t1.y+1.0);
+	track_marks_t& tm = *track_store;
+	std::size_t slot = tm.current;
+	if (slot != NO_TRACK_MARK) {
+		SetTrackType(tm, slot, TRACK_TAIL);
+		track_vertex_t* q = TrackQuad(tm, slot);
+		q[0].u = 0.0;
+		q[0].v = 0.0;
+		q[1].u = 1.0;
+		q[1].v = 0.0;
+		q[2].u = 0.0;
+		q[2].v = 1.0;
+		q[3].u = 1.0;
+		q[3].v = 1.0;
+		std::size_t prev = PrevTrackSlot(tm, slot);
+		if (prev != NO_TRACK_MARK) {
+			track_vertex_t* qprev = TrackQuad(tm, prev);
+			qprev[2].v = std::max(qprev[2].v+0.5, qprev[0].v+1.0);
+			qprev[3].v = std::max(qprev[2].v+0.5, qprev[0].v+1.0);
+			tm.dirty.push_back(prev);
 		}
 	}
 	continuing_track = false;
+	track_store = nullptr;
 }
 
-void add_track_mark(const CControl *ctrl, int *id) {
-	if (param.perf_level < 3)
-		return;
-
-	*id = Course.GetTerrainIdx(ctrl->cpos.x, ctrl->cpos.z, 0.5);
-	if (*id < 1) {
+static void add_track_mark(const CControl *ctrl) {
+	int id = Course.GetTerrainIdx(ctrl->cpos.x, ctrl->cpos.z, 0.5);
+	if (id < 1 || (std::size_t)id >= track_stores.size() || track_stores[id].capacity == 0) {
 		break_track_marks();
 		return;
 	}
 
-	if (!Course.TerrList[*id].trackmarks) {
+	// a track doesn't continue into another terrain
+	track_marks_t& tm = track_stores[id];
+	if (continuing_track && track_store != &tm)
 		break_track_marks();
-		return;
-	}
 
 	double speed = ctrl->cvel.Length();
 	if (speed < SPEED_TO_START_TRENCH) {
@@ -244,62 +352,53 @@ void add_track_mark(const CControl *ctrl, int *id) {
 		return;
 	}
 
-	if (track_marks.quads.size() < MAX_TRACK_MARKS)
-		track_marks.quads.emplace_back();
-	std::list<track_quad_t>::iterator qprev = track_marks.current_mark;
-	if (track_marks.current_mark == track_marks.quads.end())
-		track_marks.current_mark = track_marks.quads.begin();
+	AllocTrackStore(tm);
+	std::size_t prev = tm.current;
+	if (tm.count < tm.capacity)
+		tm.count++;
+	if (prev == NO_TRACK_MARK)
+		tm.current = 0;
 	else
-		track_marks.current_mark = incrementRingIterator(track_marks.current_mark);
-	std::list<track_quad_t>::iterator q = track_marks.current_mark;
+		tm.current = (prev + 1) % tm.capacity;
+	std::size_t slot = tm.current;
+	track_vertex_t* q = TrackQuad(tm, slot);
+
+	TVector3d left_pt(left_wing.x, left_y + tm.height, left_wing.z);
+	TVector3d right_pt(right_wing.x, right_y + tm.height, right_wing.z);
+	uint8_t alpha = std::min(static_cast<int>((2*comp_depth-dist_from_surface)/(4*comp_depth)*255), 255);
 
 	if (!continuing_track) {
-		q->track_type = TRACK_HEAD;
-		q->v1 = TVector3d(left_wing.x, left_y + TRACK_HEIGHT, left_wing.z);
-		q->v2 = TVector3d(right_wing.x, right_y + TRACK_HEIGHT, right_wing.z);
-		q->v3 = TVector3d(left_wing.x, left_y + TRACK_HEIGHT, left_wing.z);
-		q->v4 = TVector3d(right_wing.x, right_y + TRACK_HEIGHT, right_wing.z);
-		q->n1 = Course.FindCourseNormal(q->v1.x, q->v1.z);
-		q->n2 = Course.FindCourseNormal(q->v2.x, q->v2.z);
-		q->n3 = Course.FindCourseNormal(q->v3.x, q->v3.z);
-		q->n4 = Course.FindCourseNormal(q->v4.x, q->v4.z);
-		q->t1 = TVector2d(0.0, 0.0);
-		q->t2 = TVector2d(1.0, 0.0);
-		q->t3 = TVector2d(0.0, 1.0);
-		q->t4 = TVector2d(1.0, 1.0);
+		SetTrackType(tm, slot, TRACK_HEAD);
+		SetTrackVertex(&q[0], left_pt, 0.0, 0.0);
+		SetTrackVertex(&q[1], right_pt, 1.0, 0.0);
+		SetTrackVertex(&q[2], left_pt, 0.0, 1.0);
+		SetTrackVertex(&q[3], right_pt, 1.0, 1.0);
+		q[0].col[3] = q[1].col[3] = alpha;
 	} else {
-		q->track_type = TRACK_TAIL;
-		q->v1 = qprev->v3;
-		q->v2 = qprev->v4;
-		q->v3 = TVector3d(left_wing.x, left_y + TRACK_HEIGHT, left_wing.z);
-		q->v4 = TVector3d(right_wing.x, right_y + TRACK_HEIGHT, right_wing.z);
-		q->n1 = qprev->n3;
-		q->n2 = qprev->n4;
-		q->n3 = Course.FindCourseNormal(q->v3.x, q->v3.z);
-		q->n4 = Course.FindCourseNormal(q->v4.x, q->v4.z);
-		q->t1 = qprev->t3;
-		q->t2 = qprev->t4;
-		double tex_end = speed*g_game.time_step/TRACK_WIDTH;
-		q->t3 = TVector2d(0.0, q->t1.y + tex_end);
-		q->t4 = TVector2d(1.0, q->t2.y + tex_end);
-		if (qprev->track_type == TRACK_TAIL)
-			qprev->track_type = TRACK_MARK;
+		// v1 and v2 are shared with the previous mark, including its alpha
+		SetTrackType(tm, slot, TRACK_TAIL);
+		const track_vertex_t* qprev = TrackQuad(tm, prev);
+		q[0] = qprev[2];
+		q[1] = qprev[3];
+		// the texture follows the distance to the previous mark, which
+		// doesn't depend on how often marks are added
+		TVector3d prev_mid(0.5 * (q[0].x + q[1].x), 0.5 * (q[0].y + q[1].y), 0.5 * (q[0].z + q[1].z));
+		double tex_end = (0.5 * (left_pt + right_pt) - prev_mid).Length() / TRACK_WIDTH;
+		SetTrackVertex(&q[2], left_pt, 0.0, q[0].v + tex_end);
+		SetTrackVertex(&q[3], right_pt, 1.0, q[1].v + tex_end);
+		if (tm.types[prev] == TRACK_TAIL)
+			SetTrackType(tm, prev, TRACK_MARK);
 	}
-	q->alpha = std::min(static_cast<int>((2*comp_depth-dist_from_surface)/(4*comp_depth)*255), 255);
+	q[2].col[3] = q[3].col[3] = alpha;
 	continuing_track = true;
+	track_store = &tm;
 }
 
 void UpdateTrackmarks(const CControl *ctrl) {
-	if (param.perf_level < 3)
+	if (!EffectBudget.Enabled(EFFECT_TRACKS)) {
+		break_track_marks();
 		return;
-
-	int trackid;
-	TTerrType *TerrList = &Course.TerrList[0];
-
-	add_track_mark(ctrl, &trackid);
-	if (trackid >= 0 && TerrList[trackid].trackmarks) {
-		SetTrackIDs(TerrList[trackid].starttex,
-		            TerrList[trackid].tracktex,
-		            TerrList[trackid].stoptex);
 	}
+	CEffectBudget::Timer timer(EFFECT_TRACKS);
+	add_track_mark(ctrl);
 }
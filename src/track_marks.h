@@ -15,9 +15,9 @@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 GNU General Public License for more details.
 ---------------------------------------------------------------------*/
 
-// This code is from Tuxracer 0.61. It works but it is only suitable for
-// snow tracks. To make the code usable for other terrains (mud, snowy ice etc.)
-// it must be rewritten. Trial code exists for Bunny Hill.
+// Based on the code of Tuxracer 0.61. The textures, the height and the
+// number of marks come from the profile of each terrain type in
+// terrains.lst, every type keeps its marks separately.
 
 #ifndef TRACK_MARKS_H
 #define TRACK_MARKS_H
@@ -27,7 +27,6 @@ GNU General Public License for more details.
 void init_track_marks();
 void break_track_marks();
 
-void SetTrackIDs(int id1, int id2, int id3);
 void UpdateTrackmarks(const CControl *ctrl);
 void DrawTrackmarks();
 
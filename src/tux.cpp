@@ -32,6 +32,7 @@ still shaped with spheres.
 #include "physics.h"
 #include <GL/glu.h>
 #include <algorithm>
+#include <unordered_map>
 
 #define MAX_ARM_ANGLE2 30.0
 #define MAX_PADDLING_ANGLE2 35.0
@@ -65,6 +66,7 @@ CCharShape::CCharShape() {
 	useHighlighting = false;
 	highlighted = false;
 	highlight_node = -1;
+	override_mat = nullptr;
 }
 
 CCharShape::~CCharShape() {
@@ -363,13 +365,25 @@ void CCharShape::CreateMaterial(const std::string& line) {
 //				drawing
 // --------------------------------------------------------------------
 
+// The sphere meshes are compiled once per number of divisions and shared
+// by all shapes, the player and the ghosts.
+static std::unordered_map<int, GLuint> sphere_lists;
+
 void CCharShape::DrawCharSphere(int num_divisions) const {
-	GLUquadricObj *qobj = gluNewQuadric();
-	gluQuadricDrawStyle(qobj, GLU_FILL);
-	gluQuadricOrientation(qobj, GLU_OUTSIDE);
-	gluQuadricNormals(qobj, GLU_SMOOTH);
-	gluSphere(qobj, 1.0, (GLint)2.0 * num_divisions, num_divisions);
-	gluDeleteQuadric(qobj);
+	GLuint& list = sphere_lists[num_divisions];
+	if (list == 0) {
+		list = glGenLists(1);
+		glNewList(list, GL_COMPILE);
+		GLUquadricObj *qobj = gluNewQuadric();
+		gluQuadricDrawStyle(qobj, GLU_FILL);
+		gluQuadricOrientation(qobj, GLU_OUTSIDE);
+		gluQuadricNormals(qobj, GLU_SMOOTH);
+		gluSphere(qobj, 1.0, (GLint)2.0 * num_divisions, num_divisions);
+		gluDeleteQuadric(qobj);
+		glEndList();
+	}
+	glCallList(list);
+	num_draw_calls++;
 }
 
 void CCharShape::DrawNodes(const TCharNode *node) {
@@ -378,7 +392,9 @@ void CCharShape::DrawNodes(const TCharNode *node) {
 
 	if (node->node_name == highlight_node) highlighted = true;
 	const TCharMaterial *mat;
-	if (highlighted && useHighlighting) {
+	if (override_mat != nullptr) {
+		mat = override_mat;
+	} else if (highlighted && useHighlighting) {
 		mat = &Highlight;
 	} else {
 		if (node->mat != nullptr && useMaterials) mat = node->mat;
@@ -413,10 +429,22 @@ void CCharShape::Draw() {
 
 	DrawNodes(node);
 	glDisable(GL_NORMALIZE);
-	if (param.perf_level > 2 && g_game.argument == 0) DrawShadow();
+	if (param.perf_level > 2 && (g_game.argument == 0 || g_game.argument == 6)) DrawShadow();
 	highlighted = false;
 }
 
+void CCharShape::DrawGhost(const TCharMaterial& mat) {
+	const TCharNode *node = GetNode(0);
+	if (node == nullptr) return;
+
+	ScopedRenderMode rm(TUX);
+	glEnable(GL_NORMALIZE);
+	override_mat = &mat;
+	DrawNodes(node);
+	override_mat = nullptr;
+	glDisable(GL_NORMALIZE);
+}
+
 // --------------------------------------------------------------------
 
 bool CCharShape::Load(const std::string& dir, const std::string& filename, bool with_actions) {
@@ -533,19 +561,48 @@ void CCharShape::AdjustOrientation(CControl *ctrl, double dtime,
 
 	ctrl->plane_nml = RotateVector(ctrl->corientation, minus_z_vec);
 	ctrl->cdirection = RotateVector(ctrl->corientation, y_vec);
-	cob_mat = MakeMatrixFromQuaternion(ctrl->corientation);
+	TransformRoot(ctrl->corientation, ctrl->roll_factor, ctrl->flip_factor);
+}
+
+void CCharShape::TransformRoot(const TQuaternion& orientation, double roll_factor, double flip_factor) {
+	TMatrix<4, 4> cob_mat = MakeMatrixFromQuaternion(orientation);
 
 	// Trick rotations
-	new_y = TVector3d(cob_mat[1][0], cob_mat[1][1], cob_mat[1][2]);
-	TMatrix<4, 4> rot_mat = RotateAboutVectorMatrix(new_y, (ctrl->roll_factor * 360));
+	TVector3d new_y(cob_mat[1][0], cob_mat[1][1], cob_mat[1][2]);
+	TMatrix<4, 4> rot_mat = RotateAboutVectorMatrix(new_y, (roll_factor * 360));
 	cob_mat = rot_mat * cob_mat;
-	new_x = TVector3d(cob_mat[0][0], cob_mat[0][1], cob_mat[0][2]);
-	rot_mat = RotateAboutVectorMatrix(new_x, ctrl->flip_factor * 360);
+	TVector3d new_x(cob_mat[0][0], cob_mat[0][1], cob_mat[0][2]);
+	rot_mat = RotateAboutVectorMatrix(new_x, flip_factor * 360);
 	cob_mat = rot_mat * cob_mat;
 
 	TransformNode(0, cob_mat, cob_mat.GetTransposed());
 }
 
+void CCharShape::GetTransforms(std::vector<TMatrix<4, 4> >& trans, std::vector<TMatrix<4, 4> >& invtrans) const {
+	trans.resize(numNodes);
+	invtrans.resize(numNodes);
+	for (std::size_t i = 0; i < numNodes; i++) {
+		trans[i] = Nodes[i]->trans;
+		invtrans[i] = Nodes[i]->invtrans;
+	}
+}
+
+void CCharShape::SetTransforms(const std::vector<TMatrix<4, 4> >& trans, const std::vector<TMatrix<4, 4> >& invtrans) {
+	std::size_t num = std::min(numNodes, trans.size());
+	for (std::size_t i = 0; i < num; i++) {
+		Nodes[i]->trans = trans[i];
+		Nodes[i]->invtrans = invtrans[i];
+	}
+}
+
+// places the whole shape, used for drawing between two physics steps
+void CCharShape::PlaceRoot(const TVector3d& pos, const TQuaternion& orientation,
+                           double roll_factor, double flip_factor) {
+	ResetNode(0);
+	TranslateNode(0, pos);
+	TransformRoot(orientation, roll_factor, flip_factor);
+}
+
 void CCharShape::AdjustJoints(double turnFact, bool isBraking,
                               double paddling_factor, double speed,
                               const TVector3d& net_force, double flap_factor) {
@@ -686,6 +743,7 @@ void CCharShape::DrawShadowSphere(const TMatrix<4, 4>& mat) const {
 			z = cos_phi_d_phi;
 			DrawShadowVertex(x, y, z, mat);
 			glEnd();
+			num_draw_calls++;
 		} else if (phi + d_phi + eps >= M_PI) {
 			glBegin(GL_TRIANGLE_FAN);
 			DrawShadowVertex(0., 0., -1., mat);
@@ -702,6 +760,7 @@ void CCharShape::DrawShadowSphere(const TMatrix<4, 4>& mat) const {
 			z = cos_phi;
 			DrawShadowVertex(x, y, z, mat);
 			glEnd();
+			num_draw_calls++;
 		} else {
 			glBegin(GL_TRIANGLE_STRIP);
 			for (theta = 0.0; theta + eps < twopi; theta += d_theta) {
@@ -726,6 +785,7 @@ void CCharShape::DrawShadowSphere(const TMatrix<4, 4>& mat) const {
 			z = cos_phi_d_phi;
 			DrawShadowVertex(x, y, z, mat);
 			glEnd();
+			num_draw_calls++;
 		}
 	}
 }
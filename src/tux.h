@@ -94,6 +94,7 @@ private:
 	void CreateMaterial(const std::string& line);
 
 	// drawing
+	const TCharMaterial *override_mat;	// for all nodes, as for a ghost
 	void DrawCharSphere(int num_divisions) const;
 	void DrawNodes(const TCharNode *node);
 	TVector3d AdjustRollvector(const CControl *ctrl, const TVector3d& vel, const TVector3d& zvec);
@@ -128,10 +129,13 @@ public:
 	void ScaleNode(std::size_t node_name, const TVector3d& vec);
 	void ResetRoot() { ResetNode(0); }
 	void ResetJoints();
+	void TransformRoot(const TQuaternion& orientation, double roll_factor, double flip_factor);
 
 	// global functions
 	void Reset();
 	void Draw();
+	// the shape in one material and without shadow
+	void DrawGhost(const TCharMaterial& mat);
 	void DrawShadow() const;
 	bool Load(const std::string& dir, const std::string& filename, bool with_actions);
 
@@ -140,6 +144,11 @@ public:
 	void AdjustJoints(double turnFact, bool isBraking,
 	                  double paddling_factor, double speed,
 	                  const TVector3d& net_force, double flap_factor);
+	void PlaceRoot(const TVector3d& pos, const TQuaternion& orientation,
+	               double roll_factor, double flip_factor);
+	// the transforms of all nodes, for a copy of the shape on another thread
+	void GetTransforms(std::vector<TMatrix<4, 4> >& trans, std::vector<TMatrix<4, 4> >& invtrans) const;
+	void SetTransforms(const std::vector<TMatrix<4, 4> >& trans, const std::vector<TMatrix<4, 4> >& invtrans);
 	bool Collision(const TVector3d& pos, const TPolyhedron& ph);
 
 	std::size_t GetNodeName(std::size_t idx) const;
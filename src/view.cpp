@@ -171,6 +171,8 @@ void update_view(CControl *ctrl, float dt) {
 		return;
 	}
 
+	// the player as drawn, between the last two physics steps
+	const TVector3d pos = ctrl->DrawPos();
 	TVector3d view_pt(0,0,0);
 	TVector3d view_dir;
 
@@ -194,7 +196,7 @@ void update_view(CControl *ctrl, float dt) {
 			vel_proj.Norm();
 			TQuaternion rot_quat = MakeRotationQuaternion(mz_vec, vel_proj);
 			view_vec = RotateVector(rot_quat, view_vec);
-			view_pt = ctrl->cpos + view_vec;
+			view_pt = pos + view_vec;
 			double ycoord = Course.FindYCoord(view_pt.x, view_pt.z);
 
 			if (view_pt.y < ycoord + MIN_CAMERA_HEIGHT) {
@@ -203,7 +205,7 @@ void update_view(CControl *ctrl, float dt) {
 
 			if (ctrl->view_init) {
 				for (int i=0; i<2; i++) {
-					view_pt = interpolate_view_pos(ctrl->cpos, ctrl->cpos,
+					view_pt = interpolate_view_pos(pos, pos,
 					                               MAX_CAMERA_PITCH, ctrl->viewpos,
 					                               view_pt, camera_distance, dt,
 					                               BEHIND_ORBIT_TIME_CONSTANT *
@@ -216,7 +218,7 @@ void update_view(CControl *ctrl, float dt) {
 				view_pt.y = ycoord + ABSOLUTE_MIN_CAMERA_HEIGHT;
 			}
 
-			view_vec = view_pt - ctrl->cpos;
+			view_vec = view_pt - pos;
 			TVector3d axis = CrossProduct(y_vec, view_vec);
 			axis.Norm();
 			TMatrix<4, 4> rot_mat = RotateAboutVectorMatrix(axis, PLAYER_ANGLE_IN_CAMERA);
@@ -238,7 +240,7 @@ void update_view(CControl *ctrl, float dt) {
 			vel_proj.Norm();
 			TQuaternion rot_quat = MakeRotationQuaternion(mz_vec, vel_proj);
 			view_vec = RotateVector(rot_quat, view_vec);
-			view_pt = ctrl->cpos + view_vec;
+			view_pt = pos + view_vec;
 			double ycoord = Course.FindYCoord(view_pt.x, view_pt.z);
 			if (view_pt.y < ycoord + MIN_CAMERA_HEIGHT) {
 				view_pt.y = ycoord + MIN_CAMERA_HEIGHT;
@@ -246,7 +248,7 @@ void update_view(CControl *ctrl, float dt) {
 
 			if (ctrl->view_init) {
 				for (int i=0; i<2; i++) {
-					view_pt = interpolate_view_pos(ctrl->plyr_pos, ctrl->cpos,
+					view_pt = interpolate_view_pos(ctrl->plyr_pos, pos,
 					                               MAX_CAMERA_PITCH, ctrl->viewpos,
 					                               view_pt, camera_distance, dt,
 					                               FOLLOW_ORBIT_TIME_CONSTANT *
@@ -258,7 +260,7 @@ void update_view(CControl *ctrl, float dt) {
 				view_pt.y = ycoord + ABSOLUTE_MIN_CAMERA_HEIGHT;
 			}
 
-			view_vec = view_pt - ctrl->cpos;
+			view_vec = view_pt - pos;
 			TVector3d axis = CrossProduct(y_vec, view_vec);
 			axis.Norm();
 			TMatrix<4, 4> rot_mat = RotateAboutVectorMatrix(axis, PLAYER_ANGLE_IN_CAMERA);
@@ -276,13 +278,13 @@ void update_view(CControl *ctrl, float dt) {
 		}
 
 		case ABOVE: {
-			view_pt = ctrl->cpos + view_vec;
+			view_pt = pos + view_vec;
 			double ycoord = Course.FindYCoord(view_pt.x, view_pt.z);
 			if (view_pt.y < ycoord + MIN_CAMERA_HEIGHT) {
 				view_pt.y = ycoord + MIN_CAMERA_HEIGHT;
 			}
 
-			view_vec = view_pt - ctrl->cpos;
+			view_vec = view_pt - pos;
 			TMatrix<4, 4> rot_mat;
 			rot_mat.SetRotationMatrix(PLAYER_ANGLE_IN_CAMERA, 'x');
 			view_dir = -TransformVector(rot_mat, view_vec);
@@ -298,7 +300,7 @@ void update_view(CControl *ctrl, float dt) {
 	ctrl->viewpos = view_pt;
 	ctrl->viewdir = view_dir;
 	ctrl->viewup = TVector3d(0, 1, 0);
-	ctrl->plyr_pos = ctrl->cpos;
+	ctrl->plyr_pos = pos;
 	ctrl->view_init = true;
 
 	if (shall_stationary) {
@@ -314,8 +316,7 @@ void update_view(CControl *ctrl, float dt) {
 //					viewfrustum
 // --------------------------------------------------------------------
 
-static TPlane frustum_planes[6];
-static char p_vertex_code[6];
+static TViewFrustum frustum;
 
 
 void SetupViewFrustum(const CControl *ctrl) {
@@ -326,6 +327,7 @@ void SetupViewFrustum(const CControl *ctrl) {
 	double half_fov = ANGLES_TO_RADIANS(param.fov * 0.5);
 	double half_fov_horiz = std::atan(std::tan(half_fov) * aspect);
 
+	TPlane* frustum_planes = frustum.planes;
 	frustum_planes[0] = TPlane(0, 0, 1, near_dist);
 	frustum_planes[1] = TPlane(0, 0, -1, -far_dist);
 	frustum_planes[2]
@@ -348,15 +350,19 @@ void SetupViewFrustum(const CControl *ctrl) {
 		                          frustum_planes[i].nml,
 		                          pt);
 
-		p_vertex_code[i] = 0;
+		frustum.p_vertex_code[i] = 0;
 
-		if (frustum_planes[i].nml.x > 0) p_vertex_code[i] |= 4;
-		if (frustum_planes[i].nml.y > 0) p_vertex_code[i] |= 2;
-		if (frustum_planes[i].nml.z > 0) p_vertex_code[i] |= 1;
+		if (frustum_planes[i].nml.x > 0) frustum.p_vertex_code[i] |= 4;
+		if (frustum_planes[i].nml.y > 0) frustum.p_vertex_code[i] |= 2;
+		if (frustum_planes[i].nml.z > 0) frustum.p_vertex_code[i] |= 1;
 	}
 }
 
-clip_result_t clip_aabb_to_view_frustum(const TVector3d& min, const TVector3d& max) {
+const TViewFrustum& GetViewFrustum() {
+	return frustum;
+}
+
+clip_result_t TViewFrustum::Clip(const TVector3d& min, const TVector3d& max) const {
 	bool intersect = false;
 
 	for (int i=0; i<6; i++) {
@@ -378,11 +384,11 @@ clip_result_t clip_aabb_to_view_frustum(const TVector3d& min, const TVector3d& m
 			n.z = min.z;
 		}
 
-		if (DotProduct(n, frustum_planes[i].nml) + frustum_planes[i].d > 0) {
+		if (DotProduct(n, planes[i].nml) + planes[i].d > 0) {
 			return NotVisible;
 		}
 
-		if (DotProduct(p, frustum_planes[i].nml) + frustum_planes[i].d > 0) {
+		if (DotProduct(p, planes[i].nml) + planes[i].d > 0) {
 			intersect = true;
 		}
 	}
@@ -390,7 +396,11 @@ clip_result_t clip_aabb_to_view_frustum(const TVector3d& min, const TVector3d& m
 	return NoClip;
 }
 
-const TPlane& get_far_clip_plane() { return frustum_planes[1]; }
-const TPlane& get_left_clip_plane() { return frustum_planes[2]; }
-const TPlane& get_right_clip_plane() { return frustum_planes[3]; }
-const TPlane& get_bottom_clip_plane() { return frustum_planes[5]; }
+clip_result_t clip_aabb_to_view_frustum(const TVector3d& min, const TVector3d& max) {
+	return frustum.Clip(min, max);
+}
+
+const TPlane& get_far_clip_plane() { return frustum.planes[1]; }
+const TPlane& get_left_clip_plane() { return frustum.planes[2]; }
+const TPlane& get_right_clip_plane() { return frustum.planes[3]; }
+const TPlane& get_bottom_clip_plane() { return frustum.planes[5]; }
@@ -36,7 +36,15 @@ enum clip_result_t {
 	NotVisible
 };
 
+struct TViewFrustum {
+	TPlane planes[6];
+	char p_vertex_code[6];
+
+	clip_result_t Clip(const TVector3d& min, const TVector3d& max) const;
+};
+
 void SetupViewFrustum(const CControl *ctrl);
+const TViewFrustum& GetViewFrustum();
 clip_result_t clip_aabb_to_view_frustum(const TVector3d& min, const TVector3d& max);
 
 const TPlane& get_far_clip_plane();
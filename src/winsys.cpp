@@ -36,6 +36,7 @@ CWinsys Winsys;
 CWinsys::CWinsys()
 	: numJoysticks(0)
 	, sfmlRenders(false)
+	, vsync(false)
 	, auto_resolution(800, 600)
 	, scale(1.f) {
 	for (unsigned int i = 0; i < sf::Joystick::Count; i++) {
@@ -103,8 +104,8 @@ void CWinsys::SetupVideoMode(const TScreenRes& res) {
 	sf::ContextSettings ctx(bpp, 0, 0, 1, 2);
 #endif
 	window.create(sf::VideoMode(resolution.width, resolution.height, bpp), WINDOW_TITLE, style, ctx);
-	if (param.framerate)
-		window.setFramerateLimit(param.framerate);
+	// the frame rate is kept by the frame pacer
+	SetVerticalSync(param.vsync != 0);
 #ifdef _WIN32
 	HICON icon = LoadIcon(GetModuleHandle(NULL), (LPCWSTR)IDI_APPLICATION);
 	SendMessageW(window.getSystemHandle(), WM_SETICON, ICON_BIG, (LPARAM)icon);
@@ -131,6 +132,16 @@ void CWinsys::KeyRepeat(bool repeat) {
 	window.setKeyRepeatEnabled(repeat);
 }
 
+void CWinsys::SetVerticalSync(bool on) {
+	window.setVerticalSyncEnabled(on);
+	vsync = on;
+}
+
+void CWinsys::draw(const sf::Drawable& drawable, const sf::RenderStates& states) {
+	window.draw(drawable, states);
+	num_draw_calls++;
+}
+
 void CWinsys::Quit() {
 	Score.SaveHighScore();
 	SaveMessages();
@@ -36,6 +36,7 @@ private:
 
 	// sfml window
 	bool sfmlRenders;
+	bool vsync;
 	sf::RenderWindow window;
 	TScreenRes resolutions[NUM_RESOLUTIONS];
 	TScreenRes auto_resolution;
@@ -53,12 +54,14 @@ public:
 	void SetupVideoMode(std::size_t idx);
 	void SetupVideoMode(int width, int height);
 	void KeyRepeat(bool repeat);
+	void SetVerticalSync(bool on);
+	bool VerticalSync() const { return vsync; }
 	void PrintJoystickInfo() const;
 	void ShowCursor(bool visible) { window.setMouseCursorVisible(visible); }
 	void SwapBuffers() { window.display(); }
 	void Quit();
 	void Terminate();
-	void draw(const sf::Drawable& drawable, const sf::RenderStates& states = sf::RenderStates::Default) { window.draw(drawable, states); }
+	void draw(const sf::Drawable& drawable, const sf::RenderStates& states = sf::RenderStates::Default);
 	void clear() { window.clear(colBackgr); }
 	void beginSFML() { if (!sfmlRenders) window.pushGLStates(); sfmlRenders = true; }
 	void endSFML() { if (sfmlRenders) window.popGLStates(); sfmlRenders = false; }